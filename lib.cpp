@@ -2,12 +2,62 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <set>
 #include <ctime>
 #include <algorithm>
 #include <fstream>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <sstream>
+#include <thread>
+#include <condition_variable>
+#include <deque>
+#include <unordered_set>
+#include <random>
+#include <cmath>
+#include <cstdlib>
 
 using namespace std;
 
+// Persisted records are tab-separated, one per line
+string recordField(string value)
+{
+    replace(value.begin(), value.end(), '\t', ' ');
+    replace(value.begin(), value.end(), '\n', ' ');
+    return value;
+}
+
+vector<string> splitRecord(const string &line)
+{
+    vector<string> fields;
+    size_t start = 0;
+    while (true)
+    {
+        size_t tab = line.find('\t', start);
+        fields.push_back(line.substr(start, tab == string::npos ? string::npos : tab - start));
+        if (tab == string::npos)
+            return fields;
+        start = tab + 1;
+    }
+}
+
+// Move a finished temporary file over its target. POSIX rename replaces
+// the target atomically; Windows rename fails if the target exists, so
+// there the target is briefly missing between remove and rename.
+bool replaceFile(const string &tmpPath, const string &path)
+{
+#ifdef _WIN32
+    remove(path.c_str());
+#endif
+    return rename(tmpPath.c_str(), path.c_str()) == 0;
+}
+
 // Book class definition
 class Book
 {
@@ -30,6 +80,13 @@ public:
           totalCopies(copies), availableCopies(copies),
           price(p), publicationDate(pubDate) {}
 
+    // Constructor for a record materialized from the catalog
+    Book(int id, string t, string a, string i, string g,
+         int copies, int available, double p, string pubDate)
+        : bookId(id), title(t), author(a), isbn(i), genre(g),
+          totalCopies(copies), availableCopies(available),
+          price(p), publicationDate(pubDate) {}
+
     // Getter methods
     int getBookId() const { return bookId; }
     string getTitle() const { return title; }
@@ -68,6 +125,17 @@ public:
         }
     }
 
+    // Serialize for snapshots and logs
+    string toRecord() const
+    {
+        ostringstream out;
+        out << bookId << '\t' << recordField(title) << '\t' << recordField(author)
+            << '\t' << recordField(isbn) << '\t' << recordField(genre) << '\t'
+            << totalCopies << '\t' << availableCopies << '\t' << price << '\t'
+            << recordField(publicationDate);
+        return out.str();
+    }
+
     // Display book information
     void displayInfo() const
     {
@@ -85,6 +153,161 @@ public:
     }
 };
 
+// Append-only storage for catalog strings. Records refer to their text
+// by offset/length instead of owning a std::string each.
+class StringArena
+{
+private:
+    vector<char> data;
+
+public:
+    struct Ref
+    {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    Ref add(const string &text)
+    {
+        Ref ref = {uint32_t(data.size()), uint32_t(text.size())};
+        data.insert(data.end(), text.begin(), text.end());
+        return ref;
+    }
+
+    string get(Ref ref) const
+    {
+        return string(data.data() + ref.offset, ref.length);
+    }
+
+    bool equals(Ref ref, const string &text) const
+    {
+        return ref.length == text.size() &&
+               equal(text.begin(), text.end(), data.begin() + ref.offset);
+    }
+
+    size_t bytes() const { return data.size(); }
+};
+
+// Fields touched by availability checks, circulation and inventory scans
+struct BookHot
+{
+    int32_t bookId;
+    int32_t availableCopies;
+    int32_t totalCopies;
+    uint32_t genreId; // index into the interned genre table
+};
+
+// Descriptive fields, only read when a book is displayed or searched
+struct BookCold
+{
+    StringArena::Ref title;
+    StringArena::Ref author;
+    StringArena::Ref isbn;
+    StringArena::Ref publicationDate;
+    double price;
+};
+
+// Book catalog stored as parallel hot/cold tables. Book IDs are assigned
+// sequentially, so an ID maps to its row without a lookup table.
+class BookCatalog
+{
+private:
+    vector<BookHot> hot;
+    vector<BookCold> cold;
+    StringArena strings;
+    vector<string> genres;
+    unordered_map<string, uint32_t> genreIds;
+    int baseId;
+
+    uint32_t internGenre(const string &genre)
+    {
+        auto it = genreIds.find(genre);
+        if (it != genreIds.end())
+            return it->second;
+        uint32_t id = uint32_t(genres.size());
+        genres.push_back(genre);
+        genreIds[genre] = id;
+        return id;
+    }
+
+public:
+    BookCatalog() : baseId(0) {}
+
+    size_t size() const { return hot.size(); }
+    bool empty() const { return hot.empty(); }
+
+    void add(const Book &book)
+    {
+        if (hot.empty())
+            baseId = book.getBookId();
+
+        BookHot h = {book.getBookId(), book.getAvailableCopies(),
+                     book.getTotalCopies(), internGenre(book.getGenre())};
+        BookCold c = {strings.add(book.getTitle()), strings.add(book.getAuthor()),
+                      strings.add(book.getIsbn()), strings.add(book.getPublicationDate()),
+                      book.getPrice()};
+        hot.push_back(h);
+        cold.push_back(c);
+    }
+
+    // Row index for a book ID, or -1 if the ID is unknown
+    long indexOf(int bookId) const
+    {
+        long index = long(bookId) - baseId;
+        if (index < 0 || index >= long(hot.size()) || hot[index].bookId != bookId)
+            return -1;
+        return index;
+    }
+
+    const BookHot &hotAt(size_t index) const { return hot[index]; }
+    const vector<BookHot> &hotRows() const { return hot; }
+
+    bool isAvailable(size_t index) const { return hot[index].availableCopies > 0; }
+
+    bool issueCopy(size_t index)
+    {
+        if (hot[index].availableCopies > 0)
+        {
+            hot[index].availableCopies--;
+            return true;
+        }
+        return false;
+    }
+
+    void returnCopy(size_t index)
+    {
+        if (hot[index].availableCopies < hot[index].totalCopies)
+        {
+            hot[index].availableCopies++;
+        }
+    }
+
+    string getTitle(size_t index) const { return strings.get(cold[index].title); }
+    string getAuthor(size_t index) const { return strings.get(cold[index].author); }
+    bool isbnEquals(size_t index, const string &isbn) const
+    {
+        return strings.equals(cold[index].isbn, isbn);
+    }
+
+    const vector<string> &genreNames() const { return genres; }
+
+    // Materialize a full Book record for display
+    Book get(size_t index) const
+    {
+        const BookHot &h = hot[index];
+        const BookCold &c = cold[index];
+        return Book(h.bookId, strings.get(c.title), strings.get(c.author),
+                    strings.get(c.isbn), genres[h.genreId], h.totalCopies,
+                    h.availableCopies, c.price, strings.get(c.publicationDate));
+    }
+
+    size_t memoryUsage() const
+    {
+        return hot.capacity() * sizeof(BookHot) + cold.capacity() * sizeof(BookCold) +
+               strings.bytes();
+    }
+};
+
 // User class definition
 class User
 {
@@ -96,6 +319,7 @@ private:
     string userType; // "student", "faculty", "librarian", "admin"
     string password;
     double accountBalance;
+    double outstandingFines;
     int borrowedBooks;
     int maxBooksAllowed;
     vector<int> borrowingHistory;
@@ -105,9 +329,17 @@ public:
     User(int id, string n, string e, string p, string type,
          string pass, int maxBooks = 5)
         : userId(id), name(n), email(e), phone(p), userType(type),
-          password(pass), accountBalance(0.0), borrowedBooks(0),
+          password(pass), accountBalance(0.0), outstandingFines(0.0),
+          borrowedBooks(0),
           maxBooksAllowed(maxBooks) {}
 
+    // Constructor for a persisted record
+    User(int id, string n, string e, string p, string type, string pass,
+         double balance, double fines, int borrowed, int maxBooks)
+        : userId(id), name(n), email(e), phone(p), userType(type),
+          password(pass), accountBalance(balance), outstandingFines(fines),
+          borrowedBooks(borrowed), maxBooksAllowed(maxBooks) {}
+
     // Getter methods
     int getUserId() const { return userId; }
     string getName() const { return name; }
@@ -115,6 +347,7 @@ public:
     string getPhone() const { return phone; }
     string getUserType() const { return userType; }
     double getAccountBalance() const { return accountBalance; }
+    double getOutstandingFines() const { return outstandingFines; }
     int getBorrowedBooks() const { return borrowedBooks; }
     int getMaxBooksAllowed() const { return maxBooksAllowed; }
 
@@ -124,6 +357,9 @@ public:
         return borrowedBooks < maxBooksAllowed;
     }
 
+    const vector<int> &getBorrowingHistory() const { return borrowingHistory; }
+    void addToHistory(int bookId) { borrowingHistory.push_back(bookId); }
+
     void incrementBorrowedBooks() { borrowedBooks++; }
     void decrementBorrowedBooks()
     {
@@ -142,6 +378,14 @@ public:
         return false;
     }
 
+    // Fines are debited from the account balance as they accrue;
+    // payments post a negative amount
+    void postFine(double amount)
+    {
+        outstandingFines += amount;
+        accountBalance -= amount;
+    }
+
     // Password verification
     bool verifyPassword(const string &pass) const
     {
@@ -153,6 +397,17 @@ public:
         password = newPass; // In real implementation, hash the password
     }
 
+    // Serialize for snapshots and logs
+    string toRecord() const
+    {
+        ostringstream out;
+        out << userId << '\t' << recordField(name) << '\t' << recordField(email)
+            << '\t' << recordField(phone) << '\t' << recordField(userType) << '\t'
+            << recordField(password) << '\t' << accountBalance << '\t'
+            << outstandingFines << '\t' << borrowedBooks << '\t' << maxBooksAllowed;
+        return out.str();
+    }
+
     // Display user information
     void displayInfo() const
     {
@@ -162,11 +417,201 @@ public:
         cout << "Phone: " << phone << endl;
         cout << "User Type: " << userType << endl;
         cout << "Account Balance: $" << accountBalance << endl;
+        cout << "Outstanding Fines: $" << outstandingFines << endl;
         cout << "Books Borrowed: " << borrowedBooks
              << "/" << maxBooksAllowed << endl;
     }
 };
 
+// Dates are day numbers: days since 1970-01-01, counted in the library's
+// local time zone (see LibraryClock::dayAt)
+typedef int32_t DayNumber;
+
+const int64_t SECONDS_PER_DAY = 24 * 60 * 60;
+
+// Day number of t in a zone utcOffsetSeconds east of UTC
+DayNumber dayOf(time_t t, int64_t utcOffsetSeconds = 0)
+{
+    int64_t seconds = int64_t(t) + utcOffsetSeconds;
+    return DayNumber(seconds >= 0 ? seconds / SECONDS_PER_DAY
+                                  : -((-seconds + SECONDS_PER_DAY - 1) / SECONDS_PER_DAY));
+}
+
+// Civil date <-> day number conversion (proleptic Gregorian calendar)
+DayNumber dayFromCivil(int year, int month, int day)
+{
+    year -= month <= 2;
+    int era = (year >= 0 ? year : year - 399) / 400;
+    int yearOfEra = year - era * 400;
+    int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return DayNumber(era * 146097 + dayOfEra - 719468);
+}
+
+// Day number of t in the system's local time zone, following DST changes
+DayNumber localDayOf(time_t t)
+{
+    tm local;
+#ifdef _WIN32
+    localtime_s(&local, &t);
+#else
+    localtime_r(&t, &local);
+#endif
+    return dayFromCivil(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday);
+}
+
+string formatDay(DayNumber dayNumber)
+{
+    int z = dayNumber + 719468;
+    int era = (z >= 0 ? z : z - 146096) / 146097;
+    int dayOfEra = z - era * 146097;
+    int yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int monthIndex = (5 * dayOfYear + 2) / 153;
+    int day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    int month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    int year = yearOfEra + era * 400 + (month <= 2);
+
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d", year, month, day);
+    return buffer;
+}
+
+// Parse YYYY-MM-DD
+bool parseDay(const string &text, DayNumber &dayNumber)
+{
+    int year, month, day;
+    char dash1, dash2;
+    istringstream in(text);
+    if (!(in >> year >> dash1 >> month >> dash2 >> day) || dash1 != '-' || dash2 != '-' ||
+        month < 1 || month > 12 || day < 1 || day > 31)
+        return false;
+    dayNumber = dayFromCivil(year, month, day);
+    return formatDay(dayNumber) == text.substr(0, 10); // rejects e.g. 2025-02-30
+}
+
+// Time source for the library. Interactive use reads the system clock;
+// load replays and tests inject a virtual clock so due dates and fines
+// are reproducible. The current day is cached and refreshed by tick(), so
+// date checks across many loans cost no clock reads.
+class LibraryClock
+{
+private:
+    mutable atomic<DayNumber> cachedDay;
+    mutable atomic<bool> hasCachedDay;
+
+protected:
+    void refreshDay(time_t t) const
+    {
+        cachedDay = dayAt(t);
+        hasCachedDay = true;
+    }
+
+public:
+    LibraryClock() : cachedDay(0), hasCachedDay(false) {}
+    virtual ~LibraryClock() {}
+    virtual time_t now() const = 0;
+    virtual DayNumber dayAt(time_t t) const = 0; // the library's local day
+
+    void tick() const { refreshDay(now()); }
+
+    DayNumber today() const
+    {
+        if (!hasCachedDay)
+            tick();
+        return cachedDay;
+    }
+};
+
+class SystemClock : public LibraryClock
+{
+public:
+    time_t now() const { return time(nullptr); }
+    DayNumber dayAt(time_t t) const { return localDayOf(t); }
+};
+
+// Manually driven clock for simulation; every change refreshes the day.
+// Days use a fixed UTC offset rather than the host's zone, so a simulation
+// gives the same dates on every machine.
+class VirtualClock : public LibraryClock
+{
+private:
+    atomic<int64_t> current;
+    int64_t utcOffset; // seconds east of UTC
+
+public:
+    explicit VirtualClock(time_t start, int64_t utcOffsetSeconds = 0)
+        : current(int64_t(start)), utcOffset(utcOffsetSeconds)
+    {
+        refreshDay(start);
+    }
+
+    time_t now() const { return time_t(current.load()); }
+    DayNumber dayAt(time_t t) const { return dayOf(t, utcOffset); }
+
+    void set(time_t t)
+    {
+        current = int64_t(t);
+        refreshDay(t);
+    }
+
+    void advance(int64_t seconds) { set(time_t(current.load() + seconds)); }
+};
+
+// Opening calendar: weekly closed days plus one-off closures. Loan periods
+// count open days only, so nothing falls due while the library is closed.
+class LibraryCalendar
+{
+private:
+    uint8_t closedWeekdays; // bit 0 = Sunday ... bit 6 = Saturday
+    set<DayNumber> closures;
+
+public:
+    LibraryCalendar() : closedWeekdays(0) {}
+
+    static int weekdayOf(DayNumber day)
+    {
+        return int(((day % 7) + 11) % 7); // 1970-01-01 was a Thursday
+    }
+
+    void setWeekdayClosed(int weekday, bool closed)
+    {
+        if (closed)
+            closedWeekdays |= uint8_t(1 << weekday);
+        else
+            closedWeekdays &= uint8_t(~(1 << weekday));
+    }
+
+    bool isWeekdayClosed(int weekday) const { return (closedWeekdays & (1 << weekday)) != 0; }
+
+    uint8_t getClosedWeekdays() const { return closedWeekdays; }
+    void setClosedWeekdays(uint8_t mask) { closedWeekdays = mask & 0x7f; }
+
+    void addClosure(DayNumber day) { closures.insert(day); }
+    const set<DayNumber> &getClosures() const { return closures; }
+
+    bool isOpen(DayNumber day) const
+    {
+        return !(closedWeekdays & (1 << weekdayOf(day))) && closures.count(day) == 0;
+    }
+
+    // The day that is openDays open days after start
+    DayNumber addOpenDays(DayNumber start, int openDays) const
+    {
+        if (closedWeekdays == 0x7f)
+            return start + openDays; // never open; fall back to calendar days
+
+        DayNumber day = start;
+        while (openDays > 0)
+        {
+            day++;
+            if (isOpen(day))
+                openDays--;
+        }
+        return day;
+    }
+};
+
 // Transaction class definition
 class Transaction
 {
@@ -175,51 +620,63 @@ private:
     int userId;
     int bookId;
     time_t issueDate;
-    time_t dueDate;
+    DayNumber dueDay;
     time_t returnDate;
+    DayNumber returnDay;
     string status; // "issued", "returned", "overdue"
     double fineAmount;
 
 public:
     // Constructor
-    Transaction(int tId, int uId, int bId, int loanDays = 14)
+    Transaction(int tId, int uId, int bId, time_t issuedAt, DayNumber due)
         : transactionId(tId), userId(uId), bookId(bId),
           fineAmount(0.0), status("issued")
     {
-        time(&issueDate);
-        dueDate = issueDate + (loanDays * 24 * 60 * 60); // Convert days to seconds
+        issueDate = issuedAt;
+        dueDay = due;
         returnDate = 0;
+        returnDay = 0;
     }
 
+    // Constructor for a persisted record
+    Transaction(int tId, int uId, int bId, time_t issuedAt, DayNumber due,
+                time_t returnedAt, DayNumber returnedOn, const string &state, double fine)
+        : transactionId(tId), userId(uId), bookId(bId), issueDate(issuedAt), dueDay(due),
+          returnDate(returnedAt), returnDay(returnedOn), status(state), fineAmount(fine) {}
+
     // Getter methods
     int getTransactionId() const { return transactionId; }
     int getUserId() const { return userId; }
     int getBookId() const { return bookId; }
     time_t getIssueDate() const { return issueDate; }
-    time_t getDueDate() const { return dueDate; }
+    DayNumber getDueDay() const { return dueDay; }
     time_t getReturnDate() const { return returnDate; }
     string getStatus() const { return status; }
     double getFineAmount() const { return fineAmount; }
 
     // Transaction operations
-    void returnBook()
+    void returnBook(time_t returnedAt, DayNumber today, double dailyFineRate = 1.0,
+                    double maxFine = 0.0)
     {
-        time(&returnDate);
+        returnDate = returnedAt;
+        returnDay = today;
         status = "returned";
-        calculateFine();
+        calculateFine(today, dailyFineRate, maxFine);
     }
 
-    void calculateFine(double dailyFineRate = 1.0)
+    // A maxFine of 0 means the fine is uncapped
+    void calculateFine(DayNumber today, double dailyFineRate = 1.0, double maxFine = 0.0)
     {
-        time_t currentTime;
-        time(&currentTime);
+        DayNumber compareDay = (status == "returned") ? returnDay : today;
 
-        time_t compareDate = (status == "returned") ? returnDate : currentTime;
-
-        if (compareDate > dueDate)
+        if (compareDay > dueDay)
         {
-            int overdueDays = (compareDate - dueDate) / (24 * 60 * 60);
+            int overdueDays = compareDay - dueDay;
             fineAmount = overdueDays * dailyFineRate;
+            if (maxFine > 0 && fineAmount > maxFine)
+            {
+                fineAmount = maxFine;
+            }
             if (status == "issued")
             {
                 status = "overdue";
@@ -227,651 +684,3648 @@ public:
         }
     }
 
-    bool isOverdue() const
+    bool isOverdue(DayNumber today) const
     {
-        time_t currentTime;
-        time(&currentTime);
-        return currentTime > dueDate && status == "issued";
+        return today > dueDay && status == "issued";
     }
 
-    // Display transaction information
-    void displayInfo() const
+    // Serialize for snapshots and logs. Timestamps are epoch seconds;
+    // due and return days are the library-local dates they were computed
+    // as ("-" until returned), since they cannot be re-derived reliably
+    // from the timestamps in another time zone.
+    string toRecord() const
+    {
+        ostringstream out;
+        out << transactionId << '\t' << userId << '\t' << bookId << '\t'
+            << issueDate << '\t' << formatDay(dueDay) << '\t' << returnDate << '\t'
+            << (returnDate != 0 ? formatDay(returnDay) : string("-")) << '\t'
+            << status << '\t' << fineAmount;
+        return out.str();
+    }
+
+    // Display transaction information. fineDue is the fine owed now: for
+    // an open loan it is accrued in the fines ledger, not stored here.
+    void displayInfo(double fineDue) const
     {
         cout << "Transaction ID: " << transactionId << endl;
         cout << "User ID: " << userId << endl;
         cout << "Book ID: " << bookId << endl;
         cout << "Issue Date: " << ctime(&issueDate);
-        cout << "Due Date: " << ctime(&dueDate);
+        cout << "Due Date: " << formatDay(dueDay) << endl;
         if (returnDate != 0)
         {
             cout << "Return Date: " << ctime(&returnDate);
         }
         cout << "Status: " << status << endl;
-        cout << "Fine Amount: $" << fineAmount << endl;
+        cout << "Fine Amount: $" << fineDue << endl;
     }
 };
 
-// Main Library Management System class
-class LibraryManagementSystem
+// Per-role fine policy
+struct FineRate
+{
+    double dailyRate;
+    double maxFine;
+};
+
+// Fine record, mirroring the Fines table of the design
+struct FineRecord
+{
+    int fineId;
+    int userId;
+    int transactionId;
+    double amount;
+    string paymentStatus; // "accruing", "unpaid", "paid"
+};
+
+// Fines ledger. Overdue loans accrue incrementally on a daily tick and on
+// return; every change is posted to the owning user as a delta, so
+// per-user outstanding totals never require rescanning transactions.
+class FineLedger
 {
 private:
-    vector<Book> books;
-    vector<User> users;
-    vector<Transaction> transactions;
-    map<string, int> userCredentials; // username -> userId mapping
-    int nextBookId;
-    int nextUserId;
-    int nextTransactionId;
-    User *currentUser;
+    struct AccruingLoan
+    {
+        int userId;
+        DayNumber dueDay;
+        FineRate rate;
+        double accrued;
+        int fineIndex; // -1 until the loan first accrues a fine
+    };
+
+    vector<FineRecord> fines;
+    map<int, AccruingLoan> openLoans;       // transactionId -> loan
+    multimap<DayNumber, int> accrualQueue;  // dueDay -> transactionId, uncapped loans only
+    unordered_map<int, vector<int>> finesByUser; // userId -> indexes into fines
+    map<string, FineRate> roleRates;
+    FineRate defaultRate;
+    int nextFineId;
+    function<void(int, double)> postToUser;
+
+    void removeFromQueue(int transactionId, DayNumber dueDay)
+    {
+        auto range = accrualQueue.equal_range(dueDay);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (it->second == transactionId)
+            {
+                accrualQueue.erase(it);
+                return;
+            }
+        }
+    }
+
+    // Raise a loan's fine to newAmount and post the difference
+    void applyAccrual(int transactionId, AccruingLoan &loan, double newAmount,
+                      const string &status)
+    {
+        if (newAmount > loan.accrued)
+        {
+            if (loan.fineIndex < 0)
+            {
+                FineRecord record = {nextFineId++, loan.userId, transactionId, 0.0, status};
+                fines.push_back(record);
+                loan.fineIndex = int(fines.size()) - 1;
+                finesByUser[loan.userId].push_back(loan.fineIndex);
+            }
+            postToUser(loan.userId, newAmount - loan.accrued);
+            loan.accrued = newAmount;
+            fines[loan.fineIndex].amount = newAmount;
+        }
+        if (loan.fineIndex >= 0)
+        {
+            fines[loan.fineIndex].paymentStatus = status;
+        }
+    }
 
 public:
-    // Constructor
-    LibraryManagementSystem() : nextBookId(1001), nextUserId(2001),
-                                nextTransactionId(3001), currentUser(nullptr)
+    explicit FineLedger(function<void(int, double)> poster)
+        : nextFineId(4001), postToUser(poster)
     {
-        initializeSystem();
+        defaultRate.dailyRate = 1.0;
+        defaultRate.maxFine = 25.0;
+        roleRates["student"] = defaultRate;
+        FineRate facultyRate = {0.5, 25.0};
+        roleRates["faculty"] = facultyRate;
     }
 
-    // Initialize system with sample data
-    void initializeSystem()
+    void setRate(const string &userType, double dailyRate, double maxFine)
     {
-        // Add sample books
-        addBook("The Great Gatsby", "F. Scott Fitzgerald", "978-0-7432-7356-5",
-                "Fiction", 3, 12.99, "1925-04-10");
-        addBook("To Kill a Mockingbird", "Harper Lee", "978-0-06-112008-4",
-                "Fiction", 2, 14.99, "1960-07-11");
-        addBook("1984", "George Orwell", "978-0-452-28423-4",
-                "Dystopian", 4, 13.99, "1949-06-08");
-        addBook("Data Structures and Algorithms", "Thomas Cormen",
-                "978-0-262-03384-8", "Computer Science", 5, 89.99, "2009-07-31");
+        FineRate rate = {dailyRate, maxFine};
+        roleRates[userType] = rate;
+    }
 
-        // Add sample users
-        addUser("admin", "System Administrator", "admin@library.com",
-                "555-0001", "admin", "admin123", 10);
-        addUser("librarian1", "John Smith", "john@library.com",
-                "555-0002", "librarian", "lib123", 10);
-        addUser("student1", "Alice Johnson", "alice@student.edu",
-                "555-0003", "student", "stu123", 5);
-        addUser("faculty1", "Dr. Robert Brown", "robert@university.edu",
-                "555-0004", "faculty", "fac123", 10);
+    FineRate rateFor(const string &userType) const
+    {
+        auto it = roleRates.find(userType);
+        return it != roleRates.end() ? it->second : defaultRate;
     }
 
-    // Book management methods
-    void addBook(const string &title, const string &author, const string &isbn,
-                 const string &genre, int copies, double price,
-                 const string &pubDate)
+    // Start tracking a newly issued loan
+    void openLoan(const Transaction &transaction, const string &userType)
     {
-        Book newBook(nextBookId++, title, author, isbn, genre, copies, price, pubDate);
-        books.push_back(newBook);
-        cout << "Book added successfully with ID: " << (nextBookId - 1) << endl;
+        AccruingLoan loan = {transaction.getUserId(), transaction.getDueDay(),
+                             rateFor(userType), 0.0, -1};
+        openLoans[transaction.getTransactionId()] = loan;
+        accrualQueue.insert(make_pair(loan.dueDay, transaction.getTransactionId()));
     }
 
-    void displayAllBooks() const
+    // Finalize a returned loan; the transaction holds the final fine
+    void closeLoan(const Transaction &transaction)
     {
-        if (books.empty())
-        {
-            cout << "No books available in the library." << endl;
+        auto it = openLoans.find(transaction.getTransactionId());
+        if (it == openLoans.end())
             return;
-        }
 
-        cout << "\n=== LIBRARY CATALOG ===" << endl;
-        for (const auto &book : books)
-        {
-            cout << "\n------------------------" << endl;
-            book.displayInfo();
-        }
+        AccruingLoan &loan = it->second;
+        removeFromQueue(it->first, loan.dueDay);
+        applyAccrual(it->first, loan, transaction.getFineAmount(), "unpaid");
+        openLoans.erase(it);
     }
 
-    vector<Book *> searchBooks(const string &searchTerm, const string &searchType)
+    // Daily accrual tick: only loans already past due are visited, and
+    // loans that reached their cap leave the queue
+    int accrue(DayNumber today)
     {
-        vector<Book *> results;
-        string lowerSearchTerm = searchTerm;
-        transform(lowerSearchTerm.begin(), lowerSearchTerm.end(),
-                  lowerSearchTerm.begin(), ::tolower);
-
-        for (auto &book : books)
+        int updated = 0;
+        auto it = accrualQueue.begin();
+        while (it != accrualQueue.end() && it->first < today)
         {
-            bool match = false;
+            AccruingLoan &loan = openLoans[it->second];
+            int overdueDays = today - loan.dueDay;
+            double amount = overdueDays * loan.rate.dailyRate;
+            bool capped = loan.rate.maxFine > 0 && amount >= loan.rate.maxFine;
+            if (capped)
+                amount = loan.rate.maxFine;
 
-            if (searchType == "title")
+            if (amount > loan.accrued)
             {
-                string lowerTitle = book.getTitle();
-                transform(lowerTitle.begin(), lowerTitle.end(),
-                          lowerTitle.begin(), ::tolower);
-                match = lowerTitle.find(lowerSearchTerm) != string::npos;
-            }
-            else if (searchType == "author")
-            {
-                string lowerAuthor = book.getAuthor();
-                transform(lowerAuthor.begin(), lowerAuthor.end(),
-                          lowerAuthor.begin(), ::tolower);
-                match = lowerAuthor.find(lowerSearchTerm) != string::npos;
-            }
-            else if (searchType == "isbn")
-            {
-                match = book.getIsbn() == searchTerm;
-            }
-            else if (searchType == "genre")
-            {
-                string lowerGenre = book.getGenre();
-                transform(lowerGenre.begin(), lowerGenre.end(),
-                          lowerGenre.begin(), ::tolower);
-                match = lowerGenre.find(lowerSearchTerm) != string::npos;
+                applyAccrual(it->second, loan, amount, "accruing");
+                updated++;
             }
 
-            if (match)
-            {
-                results.push_back(&book);
-            }
+            if (capped)
+                it = accrualQueue.erase(it);
+            else
+                ++it;
         }
-
-        return results;
+        return updated;
     }
 
-    // User management methods
-    void addUser(const string &username, const string &name, const string &email,
-                 const string &phone, const string &userType,
-                 const string &password, int maxBooks = 5)
+    // Mark a user's unpaid fines from returned loans as paid; returns total
+    double payUnpaidFines(int userId)
     {
-        User newUser(nextUserId++, name, email, phone, userType, password, maxBooks);
-        users.push_back(newUser);
-        userCredentials[username] = nextUserId - 1;
-        cout << "User registered successfully with ID: " << (nextUserId - 1) << endl;
-    }
+        double total = 0.0;
+        auto it = finesByUser.find(userId);
+        if (it == finesByUser.end())
+            return total;
 
-    bool login(const string &username, const string &password)
-    {
-        auto it = userCredentials.find(username);
-        if (it != userCredentials.end())
+        for (int index : it->second)
         {
-            int userId = it->second;
-            for (auto &user : users)
+            FineRecord &record = fines[index];
+            if (record.paymentStatus == "unpaid")
             {
-                if (user.getUserId() == userId && user.verifyPassword(password))
-                {
-                    currentUser = &user;
-                    cout << "Login successful! Welcome, " << user.getName() << endl;
-                    return true;
-                }
+                record.paymentStatus = "paid";
+                postToUser(userId, -record.amount);
+                total += record.amount;
             }
         }
-        cout << "Invalid username or password." << endl;
-        return false;
+        return total;
     }
 
-    void logout()
+    // Persistence support. restoreFine re-attaches a fine to its open loan
+    // (restored first with openLoan) without posting it again; the user
+    // records already include it.
+    const vector<FineRecord> &allFines() const { return fines; }
+
+    void restoreFine(const FineRecord &record)
     {
-        if (currentUser)
+        fines.push_back(record);
+        int index = int(fines.size()) - 1;
+        finesByUser[record.userId].push_back(index);
+        nextFineId = max(nextFineId, record.fineId + 1);
+
+        auto loan = openLoans.find(record.transactionId);
+        if (loan != openLoans.end())
         {
-            cout << "Goodbye, " << currentUser->getName() << "!" << endl;
-            currentUser = nullptr;
+            loan->second.accrued = record.amount;
+            loan->second.fineIndex = index;
         }
     }
 
-    bool isLoggedIn() const
+    void clear()
     {
-        return currentUser != nullptr;
+        fines.clear();
+        openLoans.clear();
+        accrualQueue.clear();
+        finesByUser.clear();
+        nextFineId = 4001;
     }
 
-    // Transaction methods
-    bool issueBook(int bookId)
+    // Fine accrued so far on an open loan (0 if it is not open)
+    double accruedFine(int transactionId) const
     {
-        if (!currentUser)
-        {
-            cout << "Please login first." << endl;
-            return false;
-        }
+        auto it = openLoans.find(transactionId);
+        return it != openLoans.end() ? it->second.accrued : 0.0;
+    }
 
-        if (!currentUser->canBorrowMore())
+    vector<FineRecord> finesForUser(int userId) const
+    {
+        vector<FineRecord> result;
+        auto it = finesByUser.find(userId);
+        if (it != finesByUser.end())
         {
-            cout << "You have reached your borrowing limit." << endl;
-            return false;
+            for (int index : it->second)
+                result.push_back(fines[index]);
         }
+        return result;
+    }
+};
 
-        // Find the book
-        Book *bookToIssue = nullptr;
-        for (auto &book : books)
+// "Patrons who borrowed X also borrowed Y" index. Counts how many patrons
+// borrowed each pair of books and keeps a top-N neighbor list per book,
+// so serving a recommendation never touches the transaction log.
+class CoBorrowIndex
+{
+private:
+    typedef pair<uint32_t, int> Neighbor; // (co-borrow count, bookId)
+
+    size_t topN;
+    unordered_map<int, unordered_map<int, uint32_t>> counts;
+    unordered_map<int, vector<Neighbor>> neighbors; // sorted by count, descending
+
+    // Keep neighbors[bookId] ordered after other's count changed
+    void updateTop(int bookId, int other, uint32_t count)
+    {
+        vector<Neighbor> &top = neighbors[bookId];
+        size_t pos = top.size();
+        for (size_t i = 0; i < top.size(); i++)
         {
-            if (book.getBookId() == bookId)
+            if (top[i].second == other)
             {
-                bookToIssue = &book;
+                pos = i;
                 break;
             }
         }
 
-        if (!bookToIssue)
+        if (pos == top.size())
         {
-            cout << "Book not found." << endl;
-            return false;
+            if (top.size() < topN)
+                top.push_back(Neighbor(count, other));
+            else if (!top.empty() && count > top.back().first)
+                top.back() = Neighbor(count, other);
+            else
+                return;
+            pos = top.size() - 1;
         }
+        top[pos].first = count;
 
-        if (!bookToIssue->isAvailable())
+        while (pos > 0 && top[pos - 1].first < top[pos].first)
         {
-            cout << "Book is not available for checkout." << endl;
-            return false;
+            swap(top[pos - 1], top[pos]);
+            pos--;
         }
+    }
 
-        // Issue the book
-        if (bookToIssue->issueBook())
-        {
-            Transaction newTransaction(nextTransactionId++, currentUser->getUserId(), bookId);
-            transactions.push_back(newTransaction);
-            currentUser->incrementBorrowedBooks();
+    void bump(int a, int b)
+    {
+        updateTop(a, b, ++counts[a][b]);
+        updateTop(b, a, ++counts[b][a]);
+    }
 
-            cout << "Book issued successfully!" << endl;
-            cout << "Transaction ID: " << (nextTransactionId - 1) << endl;
-            time_t due = newTransaction.getDueDate();
-            cout << "Due Date: " << ctime(&due);
+public:
+    // Only the most recent borrows are paired with a new one
+    static const size_t HISTORY_WINDOW = 50;
 
-            return true;
+    explicit CoBorrowIndex(size_t neighborsPerBook = 10) : topN(neighborsPerBook) {}
+
+    // Books that a new borrow of bookId pairs with. A patron contributes at
+    // most once to each pair, so repeat borrows pair with nothing.
+    static vector<int> pairsFor(const vector<int> &priorHistory, size_t priorCount,
+                                int bookId)
+    {
+        vector<int> partners;
+        if (find(priorHistory.begin(), priorHistory.begin() + priorCount, bookId) !=
+            priorHistory.begin() + priorCount)
+            return partners;
+
+        unordered_set<int> seen;
+        size_t first = priorCount > HISTORY_WINDOW ? priorCount - HISTORY_WINDOW : 0;
+        for (size_t i = first; i < priorCount; i++)
+        {
+            if (seen.insert(priorHistory[i]).second)
+                partners.push_back(priorHistory[i]);
         }
+        return partners;
+    }
 
-        return false;
+    // Incremental update for one issue event
+    void recordBorrow(const vector<int> &priorHistory, int bookId)
+    {
+        for (int other : pairsFor(priorHistory, priorHistory.size(), bookId))
+            bump(bookId, other);
     }
 
-    bool returnBook(int bookId)
+    // Up to limit co-borrowed books, most frequent first; O(N)
+    vector<int> recommend(int bookId, size_t limit) const
     {
-        if (!currentUser)
+        vector<int> result;
+        auto it = neighbors.find(bookId);
+        if (it == neighbors.end())
+            return result;
+
+        for (size_t i = 0; i < it->second.size() && i < limit; i++)
+            result.push_back(it->second[i].second);
+        return result;
+    }
+
+    // Offline rebuild from every patron's full history. Patrons are split
+    // across threads that count pairs independently; the partial counts
+    // are then merged and the neighbor lists recomputed.
+    void rebuild(const vector<vector<int>> &histories, int threadCount)
+    {
+        typedef unordered_map<int, unordered_map<int, uint32_t>> PairCounts;
+        threadCount = max(1, threadCount);
+        vector<PairCounts> partial(threadCount);
+        vector<thread> threads;
+
+        for (int t = 0; t < threadCount; t++)
         {
-            cout << "Please login first." << endl;
-            return false;
+            threads.push_back(thread([&histories, &partial, t, threadCount]
+                                     {
+                PairCounts &local = partial[t];
+                for (size_t u = t; u < histories.size(); u += threadCount)
+                {
+                    const vector<int> &history = histories[u];
+                    for (size_t i = 0; i < history.size(); i++)
+                    {
+                        for (int other : pairsFor(history, i, history[i]))
+                        {
+                            local[history[i]][other]++;
+                            local[other][history[i]]++;
+                        }
+                    }
+                } }));
         }
+        for (auto &worker : threads)
+            worker.join();
 
-        // Find the transaction
-        Transaction *transactionToReturn = nullptr;
-        for (auto &transaction : transactions)
+        counts.clear();
+        neighbors.clear();
+        for (auto &local : partial)
         {
-            if (transaction.getUserId() == currentUser->getUserId() &&
-                transaction.getBookId() == bookId &&
-                transaction.getStatus() != "returned")
+            for (auto &row : local)
             {
-                transactionToReturn = &transaction;
-                break;
+                unordered_map<int, uint32_t> &merged = counts[row.first];
+                for (auto &cell : row.second)
+                    merged[cell.first] += cell.second;
             }
         }
 
-        if (!transactionToReturn)
+        for (auto &row : counts)
         {
-            cout << "No active transaction found for this book." << endl;
-            return false;
+            vector<Neighbor> all;
+            for (auto &cell : row.second)
+                all.push_back(Neighbor(cell.second, cell.first));
+
+            size_t keep = min(topN, all.size());
+            partial_sort(all.begin(), all.begin() + keep, all.end(),
+                         [](const Neighbor &a, const Neighbor &b)
+                         { return a.first > b.first ||
+                                  (a.first == b.first && a.second < b.second); });
+            all.resize(keep);
+            neighbors[row.first] = all;
         }
+    }
+};
 
-        // Find the book and return it
-        for (auto &book : books)
-        {
-            if (book.getBookId() == bookId)
-            {
-                book.returnBook();
-                transactionToReturn->returnBook();
-                currentUser->decrementBorrowedBooks();
+// Search-as-you-type index over titles and authors. A compressed trie
+// (radix tree) holds every normalized title and author plus each of their
+// word-start suffixes, and every node keeps the top-k books beneath it by
+// loan count, so a prefix query is one walk down the trie. Edge labels are
+// slices of one shared text pool, and nothing is kept per book except its
+// loan count; a loan re-derives the book's keys from its title and author.
+class AutocompleteIndex
+{
+private:
+    typedef pair<uint32_t, int> Scored; // (loan count, bookId)
 
-                cout << "Book returned successfully!" << endl;
+    struct Node
+    {
+        uint32_t labelStart; // edge label from the parent, as a slice of text
+        uint32_t labelLength;
+        int soleBook; // the only book beneath a leaf, or -1 once top is used
+        vector<int> children;
+        vector<Scored> top; // best first
+    };
 
-                // Check for fines
-                if (transactionToReturn->getFineAmount() > 0)
-                {
-                    cout << "Fine Amount: $" << transactionToReturn->getFineAmount() << endl;
-                    cout << "Please pay the fine at the library counter." << endl;
-                }
+    size_t topK;
+    string text; // normalized titles and authors, back to back
+    vector<Node> nodes; // nodes[0] is the root
+    unordered_map<int, uint32_t> loanCounts;
 
-                return true;
-            }
-        }
+    static bool better(const Scored &a, const Scored &b)
+    {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+    }
 
-        return false;
+    uint32_t loanCount(int bookId) const
+    {
+        auto it = loanCounts.find(bookId);
+        return it == loanCounts.end() ? 0 : it->second;
     }
 
-    // Reporting methods
-    void displayUserTransactions() const
+    static Node makeNode(size_t labelStart, size_t labelLength, int soleBook)
     {
-        if (!currentUser)
-        {
-            cout << "Please login first." << endl;
+        Node node;
+        node.labelStart = uint32_t(labelStart);
+        node.labelLength = uint32_t(labelLength);
+        node.soleBook = soleBook;
+        return node;
+    }
+
+    char labelAt(const Node &node, size_t i) const
+    {
+        return text[node.labelStart + i];
+    }
+
+    // Insert or raise bookId in a node's top-k list
+    void offer(int node, uint32_t score, int bookId)
+    {
+        // A leaf with a single book ranks it by its live loan count, so
+        // only a second book needs a real list
+        int sole = nodes[node].soleBook;
+        if (sole == bookId)
             return;
+        if (sole >= 0)
+        {
+            nodes[node].top.push_back(Scored(loanCount(sole), sole));
+            nodes[node].soleBook = -1;
         }
 
-        cout << "\n=== YOUR TRANSACTIONS ===" << endl;
-        bool hasTransactions = false;
-
-        for (const auto &transaction : transactions)
+        vector<Scored> &top = nodes[node].top;
+        size_t pos = top.size();
+        for (size_t i = 0; i < top.size(); i++)
         {
-            if (transaction.getUserId() == currentUser->getUserId())
+            if (top[i].second == bookId)
             {
-                cout << "\n------------------------" << endl;
-                transaction.displayInfo();
-
-                // Display book details
-                for (const auto &book : books)
-                {
-                    if (book.getBookId() == transaction.getBookId())
-                    {
-                        cout << "Book: " << book.getTitle()
-                             << " by " << book.getAuthor() << endl;
-                        break;
-                    }
-                }
-                hasTransactions = true;
+                pos = i;
+                break;
             }
         }
 
-        if (!hasTransactions)
+        Scored entry(score, bookId);
+        if (pos == top.size())
         {
-            cout << "No transactions found." << endl;
+            if (top.size() < topK)
+                top.push_back(entry);
+            else if (better(entry, top.back()))
+                top.back() = entry;
+            else
+                return;
+            pos = top.size() - 1;
+        }
+        top[pos] = entry;
+
+        while (pos > 0 && better(top[pos], top[pos - 1]))
+        {
+            swap(top[pos], top[pos - 1]);
+            pos--;
         }
     }
 
-    void displayOverdueBooks() const
+    int findChild(int node, char first) const
     {
-        if (!currentUser || (currentUser->getUserType() != "admin" &&
-                             currentUser->getUserType() != "librarian"))
+        for (int child : nodes[node].children)
         {
-            cout << "Access denied. Admin/Librarian privileges required." << endl;
-            return;
+            if (labelAt(nodes[child], 0) == first)
+                return child;
         }
+        return -1;
+    }
 
-        cout << "\n=== OVERDUE BOOKS ===" << endl;
-        bool hasOverdue = false;
+    // Walk the trie along the key text[begin, end), offering bookId at
+    // every node. With extend unset the trie is left as it is and only the
+    // existing path is raised.
+    void insertKey(size_t begin, size_t end, int bookId, uint32_t score, bool extend)
+    {
+        int node = 0;
+        size_t pos = begin;
+        offer(node, score, bookId);
 
-        for (const auto &transaction : transactions)
+        while (pos < end)
         {
-            if (transaction.isOverdue())
+            int child = findChild(node, text[pos]);
+            if (child < 0)
             {
-                cout << "\n------------------------" << endl;
-                transaction.displayInfo();
+                if (!extend)
+                    return;
+                nodes.push_back(makeNode(pos, end - pos, bookId));
+                nodes[node].children.push_back(int(nodes.size()) - 1);
+                return;
+            }
 
-                // Display user and book details
-                for (const auto &user : users)
-                {
-                    if (user.getUserId() == transaction.getUserId())
-                    {
-                        cout << "User: " << user.getName()
-                             << " (" << user.getEmail() << ")" << endl;
-                        break;
-                    }
-                }
+            size_t labelLength = nodes[child].labelLength;
+            size_t common = 0;
+            while (common < labelLength && pos + common < end &&
+                   labelAt(nodes[child], common) == text[pos + common])
+                common++;
 
-                for (const auto &book : books)
-                {
-                    if (book.getBookId() == transaction.getBookId())
-                    {
-                        cout << "Book: " << book.getTitle()
-                             << " by " << book.getAuthor() << endl;
-                        break;
-                    }
-                }
-                hasOverdue = true;
+            if (common < labelLength)
+            {
+                if (!extend)
+                    return;
+                // Split the edge; the new middle node covers the same
+                // subtree, so it starts with the child's top-k
+                Node middle = makeNode(nodes[child].labelStart, common,
+                                       nodes[child].soleBook);
+                middle.children.push_back(child);
+                middle.top = nodes[child].top;
+                nodes[child].labelStart += uint32_t(common);
+                nodes[child].labelLength -= uint32_t(common);
+                nodes.push_back(middle);
+                int middleIndex = int(nodes.size()) - 1;
+                replace(nodes[node].children.begin(), nodes[node].children.end(),
+                        child, middleIndex);
+                child = middleIndex;
             }
-        }
 
-        if (!hasOverdue)
-        {
-            cout << "No overdue books found." << endl;
+            node = child;
+            pos += common;
+            offer(node, score, bookId);
         }
     }
 
-    // Main menu system
-    void showMainMenu()
+    // Append a book's normalized title and author to the pool and insert
+    // every word-start suffix of each
+    void insertFields(const string &title, const string &author, int bookId,
+                      uint32_t score, bool extend)
     {
-        cout << "\n=== LIBRARY MANAGEMENT SYSTEM ===" << endl;
-        cout << "1. Login" << endl;
-        cout << "2. Register New User" << endl;
-        cout << "3. View All Books" << endl;
-        cout << "4. Search Books" << endl;
-        cout << "0. Exit" << endl;
-        cout << "Choose an option: ";
+        const string fields[] = {normalize(title), normalize(author)};
+        for (const string &field : fields)
+        {
+            size_t base = text.size();
+            text += field;
+            for (size_t start = 0; start < field.size(); start++)
+            {
+                if (start == 0 || field[start - 1] == ' ')
+                    insertKey(base + start, base + field.size(), bookId, score, extend);
+            }
+        }
     }
 
-    void showUserMenu()
-    {
-        cout << "\n=== USER MENU ===" << endl;
-        cout << "Current User: " << currentUser->getName()
-             << " (" << currentUser->getUserType() << ")" << endl;
-        cout << "1. View All Books" << endl;
-        cout << "2. Search Books" << endl;
-        cout << "3. Issue Book" << endl;
-        cout << "4. Return Book" << endl;
-        cout << "5. View My Transactions" << endl;
-        cout << "6. View My Account" << endl;
+public:
+    explicit AutocompleteIndex(size_t k = 10)
+        : topK(k), nodes(1, makeNode(0, 0, -1)) {}
 
-        if (currentUser->getUserType() == "admin" ||
-            currentUser->getUserType() == "librarian")
+    // Lowercase, keep letters and digits, collapse everything else to
+    // single spaces
+    static string normalize(const string &text)
+    {
+        string result;
+        for (char c : text)
         {
-            cout << "7. Add New Book" << endl;
-            cout << "8. View Overdue Books" << endl;
-            cout << "9. View All Users" << endl;
+            unsigned char uc = static_cast<unsigned char>(c);
+            if (isalnum(uc))
+                result += char(tolower(uc));
+            else if (!result.empty() && result.back() != ' ')
+                result += ' ';
         }
+        if (!result.empty() && result.back() == ' ')
+            result.pop_back();
+        return result;
+    }
 
-        cout << "0. Logout" << endl;
-        cout << "Choose an option: ";
+    void addBook(int bookId, const string &title, const string &author)
+    {
+        insertFields(title, author, bookId, loanCount(bookId), true);
     }
 
-    void handleUserRegistration()
+    // A loan raises the book's score along each of its key paths. The
+    // keys are rebuilt in scratch space past the end of the pool, which
+    // is trimmed again once the existing paths have been raised.
+    void recordLoan(int bookId, const string &title, const string &author)
     {
-        string username, name, email, phone, userType, password;
+        uint32_t score = ++loanCounts[bookId];
+        size_t poolSize = text.size();
+        insertFields(title, author, bookId, score, false);
+        text.resize(poolSize);
+    }
 
-        cout << "Enter username: ";
-        cin >> username;
+    // Best completions for a prefix, most borrowed first
+    vector<int> complete(const string &prefix, size_t limit) const
+    {
+        vector<int> result;
+        string key = normalize(prefix);
+        int node = 0;
+        size_t pos = 0;
 
-        // Check if username already exists
-        if (userCredentials.find(username) != userCredentials.end())
+        while (pos < key.size())
         {
-            cout << "Username already exists. Please choose a different username." << endl;
-            return;
+            int child = findChild(node, key[pos]);
+            if (child < 0)
+                return result;
+
+            const Node &edge = nodes[child];
+            size_t matched = min(key.size() - pos, size_t(edge.labelLength));
+            if (text.compare(edge.labelStart, matched, key, pos, matched) != 0)
+                return result;
+            node = child;
+            pos += matched;
         }
 
-        cin.ignore(); // Clear input buffer
-        cout << "Enter full name: ";
-        getline(cin, name);
+        if (nodes[node].soleBook >= 0)
+        {
+            if (limit > 0)
+                result.push_back(nodes[node].soleBook);
+            return result;
+        }
 
-        cout << "Enter email: ";
-        cin >> email;
+        const vector<Scored> &top = nodes[node].top;
+        for (size_t i = 0; i < top.size() && i < limit; i++)
+            result.push_back(top[i].second);
+        return result;
+    }
+};
 
-        cout << "Enter phone: ";
-        cin >> phone;
+// Operations tracked by the metrics registry
+enum MetricOp
+{
+    OP_LOGIN,
+    OP_SEARCH_TITLE,
+    OP_SEARCH_AUTHOR,
+    OP_SEARCH_ISBN,
+    OP_SEARCH_GENRE,
+    OP_ISSUE_BOOK,
+    OP_RETURN_BOOK,
+    OP_REPORT_CATALOG,
+    OP_REPORT_USER_TRANSACTIONS,
+    OP_REPORT_OVERDUE,
+    OP_REPORT_USERS,
+    OP_REPORT_FINES,
+    OP_REPORT_INVENTORY,
+    OP_ISSUE_BATCH,
+    OP_RETURN_BATCH,
+    OP_AUTOCOMPLETE,
+    OP_COUNT
+};
 
-        cout << "Enter user type (student/faculty): ";
-        cin >> userType;
+const char *metricOpName(MetricOp op)
+{
+    static const char *names[OP_COUNT] = {
+        "login",
+        "search_title",
+        "search_author",
+        "search_isbn",
+        "search_genre",
+        "issue_book",
+        "return_book",
+        "report_catalog",
+        "report_user_transactions",
+        "report_overdue",
+        "report_users",
+        "report_fines",
+        "report_inventory",
+        "issue_batch",
+        "return_batch",
+        "autocomplete"};
+    return names[op];
+}
 
-        cout << "Enter password: ";
-        cin >> password;
+// HDR-style latency histogram layout: 16 linear sub-buckets per power of
+// two, giving ~6% relative precision from 1ns up to ~30 minutes.
+class LatencyHistogram
+{
+public:
+    static const int SUB_BUCKET_BITS = 4;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int MAX_SHIFT = 36;
+    static const int BUCKET_COUNT = (MAX_SHIFT + 2) * SUB_BUCKETS;
 
-        int maxBooks = (userType == "faculty") ? 10 : 5;
-        addUser(username, name, email, phone, userType, password, maxBooks);
-    }
+    static int bucketFor(uint64_t nanos)
+    {
+        const uint64_t maxValue = (uint64_t(1) << (MAX_SHIFT + SUB_BUCKET_BITS + 1)) - 1;
+        if (nanos > maxValue)
+            nanos = maxValue;
+        if (nanos < uint64_t(SUB_BUCKETS))
+            return int(nanos);
 
-    void handleBookSearch()
+        int msb = 0;
+        while ((nanos >> (msb + 1)) != 0)
+            msb++;
+        int shift = msb - SUB_BUCKET_BITS;
+        return (shift + 1) * SUB_BUCKETS + int((nanos >> shift) - SUB_BUCKETS);
+    }
+
+    // Highest value that maps to the given bucket
+    static uint64_t bucketUpperBound(int bucket)
     {
-        string searchTerm, searchType;
+        if (bucket < SUB_BUCKETS)
+            return uint64_t(bucket);
+        int shift = bucket / SUB_BUCKETS - 1;
+        uint64_t lower = uint64_t(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+        return lower + (uint64_t(1) << shift) - 1;
+    }
+};
 
-        cout << "Search by (title/author/isbn/genre): ";
-        cin >> searchType;
+// Merged view of one operation's counters and latency distribution
+struct OpStats
+{
+    uint64_t calls;
+    uint64_t failures;
+    uint64_t sumNanos;
+    vector<uint64_t> buckets;
 
-        cin.ignore(); // Clear input buffer
-        cout << "Enter search term: ";
-        getline(cin, searchTerm);
+    OpStats() : calls(0), failures(0), sumNanos(0),
+                buckets(LatencyHistogram::BUCKET_COUNT, 0) {}
 
-        vector<Book *> results = searchBooks(searchTerm, searchType);
+    uint64_t percentileNanos(double q) const
+    {
+        uint64_t total = 0;
+        for (auto count : buckets)
+            total += count;
+        if (total == 0)
+            return 0;
 
-        if (results.empty())
+        uint64_t rank = uint64_t(q * total);
+        if (rank >= total)
+            rank = total - 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < LatencyHistogram::BUCKET_COUNT; i++)
         {
-            cout << "No books found matching your search." << endl;
+            seen += buckets[i];
+            if (seen > rank)
+                return LatencyHistogram::bucketUpperBound(i);
         }
-        else
+        return LatencyHistogram::bucketUpperBound(LatencyHistogram::BUCKET_COUNT - 1);
+    }
+};
+
+// Per-thread metrics shard. Only the owning thread writes, so updates are
+// plain relaxed load/store pairs; readers merge all shards on demand.
+struct MetricsShard
+{
+    atomic<uint64_t> calls[OP_COUNT];
+    atomic<uint64_t> failures[OP_COUNT];
+    atomic<uint64_t> sumNanos[OP_COUNT];
+    atomic<uint64_t> buckets[OP_COUNT][LatencyHistogram::BUCKET_COUNT];
+
+    MetricsShard()
+    {
+        for (int op = 0; op < OP_COUNT; op++)
         {
-            cout << "\n=== SEARCH RESULTS ===" << endl;
-            for (const auto &book : results)
+            calls[op].store(0, memory_order_relaxed);
+            failures[op].store(0, memory_order_relaxed);
+            sumNanos[op].store(0, memory_order_relaxed);
+            for (int b = 0; b < LatencyHistogram::BUCKET_COUNT; b++)
+                buckets[op][b].store(0, memory_order_relaxed);
+        }
+    }
+
+    static void bump(atomic<uint64_t> &counter, uint64_t amount)
+    {
+        counter.store(counter.load(memory_order_relaxed) + amount,
+                      memory_order_relaxed);
+    }
+};
+
+// Metrics registry with per-operation counters and latency histograms
+class LibraryMetrics
+{
+private:
+    uint64_t registryId;
+    mutable mutex shardsMutex;
+    vector<unique_ptr<MetricsShard>> shards;
+
+    static uint64_t nextRegistryId()
+    {
+        static atomic<uint64_t> counter(1);
+        return counter.fetch_add(1);
+    }
+
+    MetricsShard *localShard()
+    {
+        // Fast path: the thread's last-used registry
+        static thread_local uint64_t cachedId = 0;
+        static thread_local MetricsShard *cachedShard = nullptr;
+        if (cachedId == registryId)
+            return cachedShard;
+
+        static thread_local unordered_map<uint64_t, MetricsShard *> threadShards;
+        auto it = threadShards.find(registryId);
+        if (it == threadShards.end())
+        {
+            lock_guard<mutex> lock(shardsMutex);
+            shards.push_back(unique_ptr<MetricsShard>(new MetricsShard()));
+            it = threadShards.insert(make_pair(registryId, shards.back().get())).first;
+        }
+        cachedId = registryId;
+        cachedShard = it->second;
+        return cachedShard;
+    }
+
+public:
+    LibraryMetrics() : registryId(nextRegistryId()) {}
+
+    LibraryMetrics(const LibraryMetrics &) = delete;
+    LibraryMetrics &operator=(const LibraryMetrics &) = delete;
+
+    void record(MetricOp op, uint64_t nanos, bool ok)
+    {
+        MetricsShard *shard = localShard();
+        MetricsShard::bump(shard->calls[op], 1);
+        if (!ok)
+            MetricsShard::bump(shard->failures[op], 1);
+        MetricsShard::bump(shard->sumNanos[op], nanos);
+        MetricsShard::bump(shard->buckets[op][LatencyHistogram::bucketFor(nanos)], 1);
+    }
+
+    OpStats snapshot(MetricOp op) const
+    {
+        OpStats stats;
+        lock_guard<mutex> lock(shardsMutex);
+        for (const auto &shard : shards)
+        {
+            stats.calls += shard->calls[op].load(memory_order_relaxed);
+            stats.failures += shard->failures[op].load(memory_order_relaxed);
+            stats.sumNanos += shard->sumNanos[op].load(memory_order_relaxed);
+            for (int b = 0; b < LatencyHistogram::BUCKET_COUNT; b++)
+                stats.buckets[b] += shard->buckets[op][b].load(memory_order_relaxed);
+        }
+        return stats;
+    }
+
+    // Write all metrics in Prometheus text exposition format
+    void writePrometheus(ostream &out) const
+    {
+        static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+        vector<OpStats> all;
+        for (int op = 0; op < OP_COUNT; op++)
+            all.push_back(snapshot(MetricOp(op)));
+
+        out << "# HELP lms_operations_total Operations handled by the library core." << "\n";
+        out << "# TYPE lms_operations_total counter" << "\n";
+        for (int op = 0; op < OP_COUNT; op++)
+            out << "lms_operations_total{op=\"" << metricOpName(MetricOp(op)) << "\"} "
+                << all[op].calls << "\n";
+
+        out << "# HELP lms_operation_failures_total Operations that were rejected or failed." << "\n";
+        out << "# TYPE lms_operation_failures_total counter" << "\n";
+        for (int op = 0; op < OP_COUNT; op++)
+            out << "lms_operation_failures_total{op=\"" << metricOpName(MetricOp(op)) << "\"} "
+                << all[op].failures << "\n";
+
+        out << "# HELP lms_operation_latency_seconds Operation latency." << "\n";
+        out << "# TYPE lms_operation_latency_seconds summary" << "\n";
+        for (int op = 0; op < OP_COUNT; op++)
+        {
+            const char *name = metricOpName(MetricOp(op));
+            for (double q : quantiles)
             {
-                cout << "\n------------------------" << endl;
-                book->displayInfo();
+                out << "lms_operation_latency_seconds{op=\"" << name
+                    << "\",quantile=\"" << q << "\"} "
+                    << all[op].percentileNanos(q) / 1e9 << "\n";
             }
+            out << "lms_operation_latency_seconds_sum{op=\"" << name << "\"} "
+                << all[op].sumNanos / 1e9 << "\n";
+            out << "lms_operation_latency_seconds_count{op=\"" << name << "\"} "
+                << all[op].calls << "\n";
         }
     }
 
-    void handleBookIssue()
+    // Export to a file; written to a temporary and renamed so scrapers
+    // (e.g. a node_exporter textfile collector) never see a partial file
+    // (on Windows the file can briefly be missing, see replaceFile)
+    bool exportPrometheus(const string &path) const
     {
-        int bookId;
-        cout << "Enter Book ID to issue: ";
-        cin >> bookId;
-        issueBook(bookId);
+        string tmpPath = path + ".tmp";
+        {
+            ofstream out(tmpPath.c_str());
+            if (!out)
+                return false;
+            writePrometheus(out);
+            if (!out)
+                return false;
+        }
+        return replaceFile(tmpPath, path);
     }
+};
 
-    void handleBookReturn()
+// Times an operation for its lifetime and records it on destruction
+class ScopedOpTimer
+{
+private:
+    LibraryMetrics &metrics;
+    MetricOp op;
+    bool ok;
+    chrono::steady_clock::time_point start;
+
+public:
+    ScopedOpTimer(LibraryMetrics &m, MetricOp o)
+        : metrics(m), op(o), ok(true), start(chrono::steady_clock::now()) {}
+
+    ~ScopedOpTimer()
     {
-        int bookId;
-        cout << "Enter Book ID to return: ";
-        cin >> bookId;
-        returnBook(bookId);
+        if (op == OP_COUNT)
+            return;
+        auto elapsed = chrono::steady_clock::now() - start;
+        metrics.record(op, uint64_t(chrono::duration_cast<chrono::nanoseconds>(elapsed).count()), ok);
     }
 
-    void handleDynamicAddBook()
+    void fail() { ok = false; }
+};
+
+// Asynchronous file operation handled by an I/O backend
+struct IoRequest
+{
+    enum Kind
     {
-        if (!currentUser || (currentUser->getUserType() != "admin" &&
-                             currentUser->getUserType() != "librarian"))
+        WRITE,  // truncate the file, then write data
+        APPEND, // append data
+        REMOVE  // close and delete the file
+    };
+
+    Kind kind;
+    string path;
+    string data;
+    bool closeAfter;                 // release the cached handle once done
+    function<void(bool)> onComplete; // runs on the I/O thread; may be empty
+};
+
+// Storage I/O backend interface. Requests for the same path complete in
+// submission order; submit() never waits for the write itself.
+class IoBackend
+{
+public:
+    virtual ~IoBackend() {}
+    virtual void submit(IoRequest request) = 0;
+    virtual void drain() = 0; // wait until every submitted request completed
+};
+
+// Thread-pool backend. Each path is pinned to one worker so appends to a
+// log or chunks of a snapshot stay ordered without extra locking.
+class ThreadPoolIoBackend : public IoBackend
+{
+private:
+    struct Worker
+    {
+        mutex queueMutex;
+        condition_variable queueReady;
+        deque<IoRequest> queue;
+        bool stopping;
+        map<string, unique_ptr<ofstream>> openFiles;
+        thread ioThread;
+
+        Worker() : stopping(false) {}
+    };
+
+    vector<unique_ptr<Worker>> workers;
+
+    // Requests submitted but not yet completed. A completion callback may
+    // submit follow-up work, which is counted before its parent finishes.
+    mutex pendingMutex;
+    condition_variable allDone;
+    long pending;
+
+    static bool execute(Worker &worker, IoRequest &request)
+    {
+        if (request.kind == IoRequest::REMOVE)
         {
-            cout << "Access denied. Admin/Librarian privileges required." << endl;
-            return;
+            worker.openFiles.erase(request.path);
+            remove(request.path.c_str());
+            return true;
         }
 
-        string title, author, isbn, genre, pubDate;
-        int copies;
-        double price;
-
-        cin.ignore(); // Clear input buffer
-        cout << "Enter book title: ";
-        getline(cin, title);
+        unique_ptr<ofstream> &file = worker.openFiles[request.path];
+        if (request.kind == IoRequest::WRITE || !file)
+        {
+            ios::openmode mode = ios::binary |
+                                 (request.kind == IoRequest::WRITE ? ios::trunc : ios::app);
+            file.reset(new ofstream(request.path.c_str(), mode));
+        }
 
-        cout << "Enter author name: ";
-        getline(cin, author);
+        file->write(request.data.data(), request.data.size());
+        file->flush();
+        bool ok = bool(*file);
 
-        cout << "Enter ISBN: ";
-        cin >> isbn;
+        if (request.closeAfter || !ok)
+            worker.openFiles.erase(request.path);
+        return ok;
+    }
 
-        cout << "Enter genre: ";
-        cin >> genre;
+    void run(Worker *worker)
+    {
+        while (true)
+        {
+            IoRequest request;
+            {
+                unique_lock<mutex> lock(worker->queueMutex);
+                worker->queueReady.wait(lock, [worker]
+                                        { return worker->stopping || !worker->queue.empty(); });
+                if (worker->queue.empty())
+                    return;
+                request = move(worker->queue.front());
+                worker->queue.pop_front();
+            }
 
-        cout << "Enter number of copies: ";
-        cin >> copies;
+            bool ok = execute(*worker, request);
+            if (request.onComplete)
+                request.onComplete(ok);
 
-        cout << "Enter price: $";
-        cin >> price;
+            lock_guard<mutex> lock(pendingMutex);
+            if (--pending == 0)
+                allDone.notify_all();
+        }
+    }
 
-        cout << "Enter publication date (YYYY-MM-DD): ";
-        cin >> pubDate;
+public:
+    explicit ThreadPoolIoBackend(int threadCount = 2) : pending(0)
+    {
+        for (int i = 0; i < max(1, threadCount); i++)
+        {
+            workers.push_back(unique_ptr<Worker>(new Worker()));
+            workers.back()->ioThread = thread(&ThreadPoolIoBackend::run, this,
+                                              workers.back().get());
+        }
+    }
 
-        addBook(title, author, isbn, genre, copies, price, pubDate);
+    ~ThreadPoolIoBackend()
+    {
+        drain();
+        for (auto &worker : workers)
+        {
+            lock_guard<mutex> lock(worker->queueMutex);
+            worker->stopping = true;
+            worker->queueReady.notify_all();
+        }
+        for (auto &worker : workers)
+            worker->ioThread.join();
     }
 
-    void displayAllUsers() const
+    void submit(IoRequest request)
     {
-        if (!currentUser || (currentUser->getUserType() != "admin" &&
-                             currentUser->getUserType() != "librarian"))
         {
-            cout << "Access denied. Admin/Librarian privileges required." << endl;
-            return;
+            lock_guard<mutex> lock(pendingMutex);
+            pending++;
         }
+        Worker &worker = *workers[hash<string>()(request.path) % workers.size()];
+        lock_guard<mutex> lock(worker.queueMutex);
+        worker.queue.push_back(move(request));
+        worker.queueReady.notify_one();
+    }
 
-        cout << "\n=== ALL USERS ===" << endl;
-        for (const auto &user : users)
+    void drain()
+    {
+        unique_lock<mutex> lock(pendingMutex);
+        allDone.wait(lock, [this]
+                     { return pending == 0; });
+    }
+};
+
+// Persistence layer: an append-only event log plus periodic snapshots.
+// Each snapshot starts a new log segment; once every snapshot chunk has
+// been written the snapshot is renamed into place, the checkpoint file is
+// updated and the superseded log segment is deleted. On startup recover()
+// reads the snapshot and the later log segments back.
+class DatabaseManager
+{
+public:
+    struct RecoveryResult
+    {
+        bool ok;             // false if the files on disk cannot be used
+        bool snapshotLoaded;
+        long eventsReplayed;
+        long eventsSkipped;  // records the caller did not recognize
+        string error;
+    };
+
+private:
+    // Chunks of the snapshot being written that are queued but not yet
+    // complete; the writer waits while too many are outstanding so memory
+    // stays bounded however large the state is
+    struct SnapshotProgress
+    {
+        mutex progressMutex;
+        condition_variable chunkDone;
+        int outstanding;
+        bool failed;
+
+        SnapshotProgress() : outstanding(0), failed(false) {}
+    };
+
+    string prefix;
+    unique_ptr<IoBackend> backend;
+    int generation;         // current log segment / next snapshot number
+    uint64_t nextLogSeq;
+    atomic<int> completedCheckpoints;
+    atomic<bool> snapshotInFlight;
+    atomic<uint64_t> failedLogWrites;
+    atomic<uint64_t> failedSnapshots;
+
+    // Snapshot being serialized by the caller
+    string snapshotBuffer;
+    string snapshotTmpPath;
+    int snapshotGen;
+    uint64_t snapshotSeq;
+    bool snapshotStarted; // first chunk submitted (truncates the file)
+    shared_ptr<SnapshotProgress> snapshotProgress;
+
+    string logPath(int gen) const { return prefix + ".log." + to_string(gen); }
+    string snapshotPath() const { return prefix + ".snapshot"; }
+    string checkpointPath() const { return prefix + ".checkpoint"; }
+
+    static bool fileExists(const string &path)
+    {
+        ifstream in(path.c_str());
+        return bool(in);
+    }
+
+    // Replay one log segment, stopping at a torn or malformed line (a
+    // write cut short by a crash). Returns false if the segment ended early.
+    bool replaySegment(int gen, uint64_t firstSeq,
+                       const function<bool(const vector<string> &)> &apply,
+                       RecoveryResult &result, uint64_t &lastSeq)
+    {
+        ifstream in(logPath(gen).c_str(), ios::binary);
+        string line;
+        while (getline(in, line))
         {
-            cout << "\n------------------------" << endl;
-            user.displayInfo();
+            if (in.eof())
+                return false; // no trailing newline: torn write
+
+            size_t tab = line.find('\t');
+            char *end = nullptr;
+            uint64_t seq = strtoull(line.c_str(), &end, 10);
+            if (tab == string::npos || end != line.c_str() + tab || seq <= lastSeq)
+                return false;
+
+            lastSeq = seq;
+            if (seq < firstSeq)
+                continue; // already in the snapshot
+            if (apply(splitRecord(line.substr(tab + 1))))
+                result.eventsReplayed++;
+            else
+                result.eventsSkipped++;
         }
+        return true;
     }
 
-    // Main application loop
-    void run()
+    void submitSnapshotChunk(bool last)
     {
-        int choice;
+        shared_ptr<SnapshotProgress> progress = snapshotProgress;
+        {
+            unique_lock<mutex> lock(progress->progressMutex);
+            progress->chunkDone.wait(lock, [&progress]
+                                     { return progress->outstanding < MAX_QUEUED_CHUNKS; });
+            progress->outstanding++;
+        }
 
-        cout << "Welcome to the Library Management System!" << endl;
+        IoRequest request;
+        request.kind = snapshotStarted ? IoRequest::APPEND : IoRequest::WRITE;
+        request.path = snapshotTmpPath;
+        request.data.swap(snapshotBuffer);
+        request.closeAfter = last;
+        snapshotStarted = true;
 
-        while (true)
+        if (!last)
         {
-            if (!isLoggedIn())
+            request.onComplete = [progress](bool ok)
             {
-                showMainMenu();
-                cin >> choice;
+                lock_guard<mutex> lock(progress->progressMutex);
+                progress->outstanding--;
+                progress->failed = progress->failed || !ok;
+                progress->chunkDone.notify_all();
+            };
+        }
+        else
+        {
+            // Chunks of one path complete in order, so every earlier chunk
+            // has finished when this one does
+            string tmpPath = snapshotTmpPath;
+            string finalPath = snapshotPath();
+            string checkpoint = checkpointPath();
+            string oldLog = logPath(snapshotGen);
+            int nextGen = snapshotGen + 1;
+            uint64_t logSeq = snapshotSeq;
+            IoBackend *io = backend.get();
+            atomic<int> *checkpoints = &completedCheckpoints;
+            atomic<uint64_t> *failures = &failedSnapshots;
+            atomic<bool> *inFlight = &snapshotInFlight;
 
-                switch (choice)
+            request.onComplete = [=](bool ok)
+            {
                 {
-                case 1:
+                    lock_guard<mutex> lock(progress->progressMutex);
+                    progress->outstanding--;
+                    ok = ok && !progress->failed;
+                }
+                if (ok)
+                    ok = replaceFile(tmpPath, finalPath);
+                if (ok)
                 {
-                    string username, password;
-                    cout << "Enter username: ";
-                    cin >> username;
-                    cout << "Enter password: ";
-                    cin >> password;
-                    login(username, password);
-                    break;
+                    IoRequest marker;
+                    marker.kind = IoRequest::WRITE;
+                    marker.path = checkpoint;
+                    marker.data = "generation\t" + to_string(nextGen) +
+                                  "\nlog_seq\t" + to_string(logSeq) + "\n";
+                    marker.closeAfter = true;
+                    io->submit(move(marker));
+
+                    // Queued behind any pending appends to the old segment
+                    IoRequest cleanup;
+                    cleanup.kind = IoRequest::REMOVE;
+                    cleanup.path = oldLog;
+                    cleanup.closeAfter = true;
+                    io->submit(move(cleanup));
+                    (*checkpoints)++;
                 }
-                case 2:
-                    handleUserRegistration();
-                    break;
-                case 3:
-                    displayAllBooks();
-                    break;
-                case 4:
-                    handleBookSearch();
-                    break;
-                case 0:
-                    cout << "Thank you for using Library Management System!" << endl;
-                    return;
-                default:
-                    cout << "Invalid option. Please try again." << endl;
+                else
+                {
+                    remove(tmpPath.c_str());
+                    (*failures)++;
                 }
+                *inFlight = false;
+            };
+        }
+        backend->submit(move(request));
+        snapshotBuffer.clear();
+        snapshotBuffer.reserve(SNAPSHOT_CHUNK_BYTES);
+    }
+
+public:
+    static const size_t SNAPSHOT_CHUNK_BYTES = 1 << 20;
+    static const int MAX_QUEUED_CHUNKS = 8;
+
+    DatabaseManager(const string &pathPrefix, unique_ptr<IoBackend> io)
+        : prefix(pathPrefix), backend(move(io)), generation(1), nextLogSeq(1),
+          completedCheckpoints(0), snapshotInFlight(false), failedLogWrites(0),
+          failedSnapshots(0), snapshotGen(0), snapshotSeq(0), snapshotStarted(false) {}
+
+    ~DatabaseManager()
+    {
+        backend->drain();
+    }
+
+    // Queue one event record; returns immediately. Failed writes are
+    // counted, see getFailedLogWrites().
+    void appendLog(const string &record)
+    {
+        IoRequest request;
+        request.kind = IoRequest::APPEND;
+        request.path = logPath(generation);
+        request.data = to_string(nextLogSeq++) + '\t' + record + '\n';
+        request.closeAfter = false;
+        atomic<uint64_t> *failures = &failedLogWrites;
+        request.onComplete = [failures](bool ok)
+        {
+            if (!ok)
+                (*failures)++;
+        };
+        backend->submit(move(request));
+    }
+
+    // Start a snapshot. The caller then passes every record to
+    // addSnapshotRecord() and calls finishSnapshot(); records are written
+    // in chunks as they are produced. Returns false if the previous
+    // snapshot has not been checkpointed yet.
+    bool beginSnapshot()
+    {
+        bool expected = false;
+        if (!snapshotInFlight.compare_exchange_strong(expected, true))
+            return false;
+
+        snapshotGen = generation;
+        snapshotSeq = nextLogSeq;
+        snapshotTmpPath = snapshotPath() + "." + to_string(snapshotGen) + ".tmp";
+        snapshotStarted = false;
+        snapshotProgress = make_shared<SnapshotProgress>();
+        snapshotBuffer.clear();
+        snapshotBuffer.reserve(SNAPSHOT_CHUNK_BYTES);
+
+        // Events from here on go to the next log segment
+        generation++;
+
+        // The header names the log position the snapshot covers, so it can
+        // be loaded even if the checkpoint update was lost
+        addSnapshotRecord("SNAPSHOT\t" + to_string(snapshotGen) + '\t' + to_string(snapshotSeq));
+        return true;
+    }
+
+    // Read back persisted state; must run before any new writes. The
+    // snapshot (if any) is passed record by record to applySnapshot,
+    // starting with its SNAPSHOT header, then every later log record to
+    // applyEvent. New events continue after the last record found, so a
+    // restart never reuses a sequence number or a finished segment.
+    RecoveryResult recover(const function<bool(const vector<string> &)> &applySnapshot,
+                           const function<bool(const vector<string> &)> &applyEvent)
+    {
+        RecoveryResult result = {true, false, 0, 0, ""};
+        int firstGen = 1;
+        uint64_t firstSeq = 1;
+
+        bool hasCheckpoint = false;
+        {
+            ifstream checkpoint(checkpointPath().c_str());
+            string key;
+            while (checkpoint >> key)
+            {
+                if (key == "generation")
+                    checkpoint >> firstGen;
+                else if (key == "log_seq")
+                    checkpoint >> firstSeq;
+                hasCheckpoint = true;
             }
-            else
+        }
+
+        ifstream snapshot(snapshotPath().c_str(), ios::binary);
+        if (snapshot)
+        {
+            string line;
+            vector<string> header;
+            if (getline(snapshot, line))
+                header = splitRecord(line);
+            if (header.size() != 3 || header[0] != "SNAPSHOT")
             {
-                showUserMenu();
-                cin >> choice;
+                result.ok = false;
+                result.error = snapshotPath() + " has no SNAPSHOT header";
+                return result;
+            }
 
-                switch (choice)
+            firstGen = atoi(header[1].c_str()) + 1;
+            firstSeq = strtoull(header[2].c_str(), nullptr, 10);
+            applySnapshot(header);
+            while (getline(snapshot, line))
+            {
+                if (!applySnapshot(splitRecord(line)))
                 {
-                case 1:
-                    displayAllBooks();
-                    break;
-                case 2:
-                    handleBookSearch();
-                    break;
-                case 3:
-                    handleBookIssue();
-                    break;
-                case 4:
-                    handleBookReturn();
-                    break;
-                case 5:
-                    displayUserTransactions();
-                    break;
-                case 6:
-                    currentUser->displayInfo();
-                    break;
-                case 7:
-                    if (currentUser->getUserType() == "admin" ||
+                    result.ok = false;
+                    result.error = "bad snapshot record: " + line.substr(0, 60);
+                    return result;
+                }
+            }
+            result.snapshotLoaded = true;
+        }
+        else if (hasCheckpoint)
+        {
+            result.ok = false;
+            result.error = checkpointPath() + " exists but " + snapshotPath() + " is missing";
+            return result;
+        }
+
+        uint64_t lastSeq = 0;
+        int gen = firstGen;
+        bool clean = true;
+        for (; fileExists(logPath(gen)); gen++)
+            clean = replaySegment(gen, firstSeq, applyEvent, result, lastSeq);
+
+        // Append to the last segment unless it ends in a torn record
+        generation = gen > firstGen && clean ? gen - 1 : gen;
+        nextLogSeq = max(firstSeq, lastSeq + 1);
+        return result;
+    }
+
+    void addSnapshotRecord(const string &record)
+    {
+        snapshotBuffer += record;
+        snapshotBuffer += '\n';
+        if (snapshotBuffer.size() >= SNAPSHOT_CHUNK_BYTES)
+            submitSnapshotChunk(false);
+    }
+
+    void finishSnapshot()
+    {
+        submitSnapshotChunk(true);
+        snapshotProgress.reset();
+    }
+
+    bool isSnapshotInFlight() const { return snapshotInFlight; }
+    int getCompletedCheckpoints() const { return completedCheckpoints; }
+    uint64_t getFailedLogWrites() const { return failedLogWrites; }
+    uint64_t getFailedSnapshots() const { return failedSnapshots; }
+
+    void flush() { backend->drain(); }
+};
+
+// Hierarchical timer wheel with one-second ticks. Each level has 64
+// slots; entries further out sit in coarser levels and are cascaded down
+// as time advances, so scheduling and each tick are O(1).
+class TimerWheel
+{
+private:
+    static const int LEVELS = 3;
+    static const int SLOT_BITS = 6;
+    static const int SLOTS = 1 << SLOT_BITS;
+
+    typedef pair<string, int64_t> Entry; // (key, deadline)
+    vector<Entry> slots[LEVELS][SLOTS];
+    int64_t current;
+
+public:
+    // Furthest deadline the wheel can hold; later ones are clamped and
+    // re-checked by the owner when they fire
+    static const int64_t SPAN = int64_t(1) << (SLOT_BITS * LEVELS);
+
+    explicit TimerWheel(int64_t start) : current(start) {}
+
+    void schedule(const string &key, int64_t deadline)
+    {
+        if (deadline <= current)
+            deadline = current + 1;
+        if (deadline - current >= SPAN)
+            deadline = current + SPAN - 1;
+
+        int64_t delta = deadline - current;
+        int level = 0;
+        while (level < LEVELS - 1 && delta >= (int64_t(1) << (SLOT_BITS * (level + 1))))
+            level++;
+
+        int slot = int((deadline >> (SLOT_BITS * level)) & (SLOTS - 1));
+        slots[level][slot].push_back(Entry(key, deadline));
+    }
+
+    // Advance to now, appending the keys of every expired entry to due
+    void advance(int64_t now, vector<string> &due)
+    {
+        while (current < now)
+        {
+            current++;
+
+            // Cascade coarser levels whose slot boundary was just reached
+            for (int level = LEVELS - 1; level > 0; level--)
+            {
+                if ((current & ((int64_t(1) << (SLOT_BITS * level)) - 1)) != 0)
+                    continue;
+
+                int slot = int((current >> (SLOT_BITS * level)) & (SLOTS - 1));
+                vector<Entry> entries;
+                entries.swap(slots[level][slot]);
+                for (auto &entry : entries)
+                {
+                    if (entry.second <= current)
+                        due.push_back(entry.first);
+                    else
+                        schedule(entry.first, entry.second);
+                }
+            }
+
+            vector<Entry> &expired = slots[0][current & (SLOTS - 1)];
+            for (auto &entry : expired)
+                due.push_back(entry.first);
+            expired.clear();
+        }
+    }
+};
+
+// Token-based session store. Sessions live in a striped hash map so
+// concurrent lookups only contend within one stripe. Activity just moves
+// a session's expiry time; the timer wheel entry is re-armed lazily when
+// it fires, keeping every touch O(1).
+class SessionManager
+{
+private:
+    struct Session
+    {
+        int userId;
+        int64_t expiresAt;
+    };
+
+    struct Stripe
+    {
+        mutex stripeMutex;
+        unordered_map<string, Session> sessions;
+    };
+
+    static const int STRIPES = 64;
+    Stripe stripes[STRIPES];
+    mutex wheelMutex;
+    TimerWheel wheel;
+    mutex randomMutex;
+    random_device entropy;
+    int64_t idleTimeout; // seconds
+    atomic<long> activeSessions;
+
+    Stripe &stripeFor(const string &token)
+    {
+        return stripes[hash<string>()(token) % STRIPES];
+    }
+
+    // 128-bit token drawn directly from the OS entropy source; tokens are
+    // the only credential on the token API, so they must not be
+    // predictable from one another
+    string newToken()
+    {
+        static const char hexDigits[] = "0123456789abcdef";
+        string token;
+        lock_guard<mutex> lock(randomMutex);
+        for (int word = 0; word < 4; word++)
+        {
+            uint32_t bits = uint32_t(entropy());
+            for (int i = 0; i < 8; i++, bits >>= 4)
+                token += hexDigits[bits & 0xf];
+        }
+        return token;
+    }
+
+public:
+    explicit SessionManager(time_t start, int64_t idleTimeoutSeconds = 15 * 60)
+        : wheel(int64_t(start)),
+          idleTimeout(idleTimeoutSeconds), activeSessions(0) {}
+
+    string create(int userId, time_t now)
+    {
+        string token = newToken();
+        Session session = {userId, int64_t(now) + idleTimeout};
+        {
+            Stripe &stripe = stripeFor(token);
+            lock_guard<mutex> lock(stripe.stripeMutex);
+            stripe.sessions[token] = session;
+        }
+        {
+            lock_guard<mutex> lock(wheelMutex);
+            wheel.schedule(token, session.expiresAt);
+        }
+        activeSessions++;
+        return token;
+    }
+
+    // User ID for a live session (refreshing its idle timer), or -1
+    int resolve(const string &token, time_t now)
+    {
+        Stripe &stripe = stripeFor(token);
+        lock_guard<mutex> lock(stripe.stripeMutex);
+        auto it = stripe.sessions.find(token);
+        if (it == stripe.sessions.end() || it->second.expiresAt <= now)
+            return -1;
+        it->second.expiresAt = int64_t(now) + idleTimeout;
+        return it->second.userId;
+    }
+
+    void destroy(const string &token)
+    {
+        Stripe &stripe = stripeFor(token);
+        lock_guard<mutex> lock(stripe.stripeMutex);
+        if (stripe.sessions.erase(token) > 0)
+            activeSessions--;
+    }
+
+    // Expire idle sessions; returns how many were removed
+    int tick(time_t now)
+    {
+        vector<string> due;
+        {
+            lock_guard<mutex> lock(wheelMutex);
+            wheel.advance(int64_t(now), due);
+        }
+
+        int expired = 0;
+        vector<pair<string, int64_t>> rearm;
+        for (const auto &token : due)
+        {
+            Stripe &stripe = stripeFor(token);
+            lock_guard<mutex> lock(stripe.stripeMutex);
+            auto it = stripe.sessions.find(token);
+            if (it == stripe.sessions.end())
+                continue; // already logged out
+            if (it->second.expiresAt > now)
+            {
+                rearm.push_back(make_pair(token, it->second.expiresAt));
+            }
+            else
+            {
+                stripe.sessions.erase(it);
+                activeSessions--;
+                expired++;
+            }
+        }
+
+        if (!rearm.empty())
+        {
+            lock_guard<mutex> lock(wheelMutex);
+            for (const auto &entry : rearm)
+                wheel.schedule(entry.first, entry.second);
+        }
+        return expired;
+    }
+
+    long size() const { return activeSessions; }
+};
+
+// One operation in a load trace. On disk each operation is a line of
+// tab-separated fields: time_ms, client, op, args...
+struct TraceOp
+{
+    int64_t timeMs; // offset from the start of the trace
+    int client;     // operations of one client replay in order on one thread
+    string op;
+    vector<string> args;
+};
+
+// Writes trace files for the load replayer. Traces include login
+// credentials so they can be replayed; treat them like credential files.
+class TraceRecorder
+{
+private:
+    ofstream out;
+    mutex writeMutex;
+    chrono::steady_clock::time_point start;
+
+public:
+    explicit TraceRecorder(const string &path)
+        : out(path.c_str()), start(chrono::steady_clock::now())
+    {
+        out << "# lms-trace v1" << '\n';
+    }
+
+    bool isOpen() const { return bool(out); }
+
+    void write(const TraceOp &op)
+    {
+        lock_guard<mutex> lock(writeMutex);
+        out << op.timeMs << '\t' << op.client << '\t' << op.op;
+        for (const auto &arg : op.args)
+            out << '\t' << recordField(arg);
+        out << '\n';
+    }
+
+    // Record an operation happening now
+    void record(int client, const string &op, const vector<string> &args)
+    {
+        TraceOp traced;
+        traced.timeMs = chrono::duration_cast<chrono::milliseconds>(
+                            chrono::steady_clock::now() - start)
+                            .count();
+        traced.client = client;
+        traced.op = op;
+        traced.args = args;
+        write(traced);
+    }
+
+    static bool load(const string &path, vector<TraceOp> &ops)
+    {
+        ifstream in(path.c_str());
+        if (!in)
+            return false;
+
+        string line;
+        while (getline(in, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+
+            vector<string> fields;
+            size_t begin = 0;
+            while (true)
+            {
+                size_t end = line.find('\t', begin);
+                fields.push_back(line.substr(begin, end - begin));
+                if (end == string::npos)
+                    break;
+                begin = end + 1;
+            }
+            if (fields.size() < 3)
+                return false;
+
+            TraceOp op;
+            op.timeMs = atoll(fields[0].c_str());
+            op.client = atoi(fields[1].c_str());
+            op.op = fields[2];
+            op.args.assign(fields.begin() + 3, fields.end());
+            ops.push_back(op);
+        }
+        return true;
+    }
+};
+
+// Per-item outcome of a batch checkout or return
+struct BatchItemResult
+{
+    int bookId;
+    bool success;
+    string message;
+};
+
+// Main Library Management System class
+class LibraryManagementSystem
+{
+private:
+    BookCatalog catalog;
+    vector<User> users;
+    vector<Transaction> transactions;
+    map<string, int> userCredentials; // username -> userId mapping
+    unordered_map<int, size_t> userIndexById; // userId -> index into users
+    int nextBookId;
+    int nextUserId;
+    int nextTransactionId;
+    User *currentUser; // the console's own session; other callers pass a token
+    LibraryClock *clock;
+    mutable LibraryMetrics metrics;
+    FineLedger fineLedger;
+    DayNumber lastFineAccrualDay;
+    LibraryCalendar calendar;
+    int loanPeriodDays; // open days
+    size_t catalogPageSize;
+    double fineBlockThreshold; // Checkout is refused at or above this amount
+    unique_ptr<DatabaseManager> database; // null when persistence is disabled
+    uint64_t reportedLogFailures;
+    uint64_t reportedSnapshotFailures;
+    CoBorrowIndex coBorrowIndex;
+    SessionManager sessions;
+    AutocompleteIndex autocomplete;
+    string currentToken; // session of the console user
+    TraceRecorder *traceRecorder; // null unless recording
+
+    static LibraryClock &systemClock()
+    {
+        static SystemClock instance;
+        return instance;
+    }
+
+    static MetricOp searchOpFor(const string &searchType)
+    {
+        if (searchType == "title")
+            return OP_SEARCH_TITLE;
+        if (searchType == "author")
+            return OP_SEARCH_AUTHOR;
+        if (searchType == "isbn")
+            return OP_SEARCH_ISBN;
+        if (searchType == "genre")
+            return OP_SEARCH_GENRE;
+        return OP_COUNT; // Unknown search types are not timed
+    }
+
+public:
+    // Constructor. Without a clock the system clock is used; an injected
+    // clock must outlive the library.
+    explicit LibraryManagementSystem(LibraryClock *timeSource = nullptr)
+        : nextBookId(1001), nextUserId(2001),
+          nextTransactionId(3001), currentUser(nullptr),
+          clock(timeSource ? timeSource : &systemClock()),
+          fineLedger([this](int userId, double amount)
+                     {
+                         User *user = findUserById(userId);
+                         if (user)
+                             user->postFine(amount);
+                     }),
+          lastFineAccrualDay(0), loanPeriodDays(14), catalogPageSize(20),
+          fineBlockThreshold(10.0), reportedLogFailures(0), reportedSnapshotFailures(0),
+          sessions(clock->now()),
+          traceRecorder(nullptr)
+    {
+        initializeSystem();
+    }
+
+    // Initialize system with sample data
+    void initializeSystem()
+    {
+        // Add sample books
+        addBook("The Great Gatsby", "F. Scott Fitzgerald", "978-0-7432-7356-5",
+                "Fiction", 3, 12.99, "1925-04-10");
+        addBook("To Kill a Mockingbird", "Harper Lee", "978-0-06-112008-4",
+                "Fiction", 2, 14.99, "1960-07-11");
+        addBook("1984", "George Orwell", "978-0-452-28423-4",
+                "Dystopian", 4, 13.99, "1949-06-08");
+        addBook("Data Structures and Algorithms", "Thomas Cormen",
+                "978-0-262-03384-8", "Computer Science", 5, 89.99, "2009-07-31");
+
+        // Add sample users
+        addUser("admin", "System Administrator", "admin@library.com",
+                "555-0001", "admin", "admin123", 10);
+        addUser("librarian1", "John Smith", "john@library.com",
+                "555-0002", "librarian", "lib123", 10);
+        addUser("student1", "Alice Johnson", "alice@student.edu",
+                "555-0003", "student", "stu123", 5);
+        addUser("faculty1", "Dr. Robert Brown", "robert@university.edu",
+                "555-0004", "faculty", "fac123", 10);
+    }
+
+    // Load trace recording; console operations are recorded as client 0
+    void setTraceRecorder(TraceRecorder *recorder) { traceRecorder = recorder; }
+
+    // Callers test traceRecorder first, so the argument list is only
+    // built while recording
+    void trace(const string &op, const vector<string> &args) const
+    {
+        traceRecorder->record(0, op, args);
+    }
+
+    // Periodic housekeeping: daily fine accrual and session expiry
+    void tick()
+    {
+        clock->tick();
+        accrueFinesIfDue();
+        sessions.tick(clock->now());
+    }
+
+    // Persistence methods
+
+    // Store data under pathPrefix, first restoring whatever an earlier run
+    // saved there. Returns false (leaving persistence off) if those files
+    // cannot be read back, so they are never overwritten.
+    bool enablePersistence(const string &pathPrefix, int ioThreads = 2)
+    {
+        unique_ptr<DatabaseManager> store(new DatabaseManager(
+            pathPrefix, unique_ptr<IoBackend>(new ThreadPoolIoBackend(ioThreads))));
+
+        DatabaseManager::RecoveryResult recovered = store->recover(
+            [this](const vector<string> &fields)
+            { return restoreSnapshotRecord(fields); },
+            [this](const vector<string> &fields)
+            { return replayEvent(fields); });
+        if (!recovered.ok)
+        {
+            cout << "Cannot restore data from " << pathPrefix << ": " << recovered.error << endl;
+            return false;
+        }
+
+        database = move(store);
+        reportedLogFailures = 0;
+        reportedSnapshotFailures = 0;
+        lastFineAccrualDay = 0; // catch up on accrual since the last run
+        if (recovered.snapshotLoaded || recovered.eventsReplayed > 0)
+        {
+            cout << "Restored " << catalog.size() << " books, " << users.size() << " users and "
+                 << transactions.size() << " transactions (" << recovered.eventsReplayed
+                 << " logged events replayed";
+            if (recovered.eventsSkipped > 0)
+                cout << ", " << recovered.eventsSkipped << " unrecognized events skipped";
+            cout << ")." << endl;
+        }
+        return true;
+    }
+
+private:
+    // Recovery helpers. Records are applied directly to the state; nothing
+    // here is logged or traced again.
+
+    void clearState()
+    {
+        catalog = BookCatalog();
+        users.clear();
+        transactions.clear();
+        userCredentials.clear();
+        userIndexById.clear();
+        fineLedger.clear();
+        calendar = LibraryCalendar();
+        coBorrowIndex = CoBorrowIndex();
+        autocomplete = AutocompleteIndex();
+    }
+
+    // Fields of a Book record starting at first; false if malformed
+    bool restoreBook(const vector<string> &f, size_t first)
+    {
+        if (f.size() < first + 9)
+            return false;
+        Book book(atoi(f[first].c_str()), f[first + 1], f[first + 2], f[first + 3],
+                  f[first + 4], atoi(f[first + 5].c_str()), atoi(f[first + 6].c_str()),
+                  atof(f[first + 7].c_str()), f[first + 8]);
+        if (!catalog.empty() && catalog.indexOf(book.getBookId() - 1) != long(catalog.size()) - 1)
+            return false; // book IDs must stay sequential
+        catalog.add(book);
+        autocomplete.addBook(book.getBookId(), book.getTitle(), book.getAuthor());
+        nextBookId = max(nextBookId, book.getBookId() + 1);
+        return true;
+    }
+
+    bool restoreUser(const vector<string> &f, size_t first)
+    {
+        if (f.size() < first + 10)
+            return false;
+        User user(atoi(f[first].c_str()), f[first + 1], f[first + 2], f[first + 3],
+                  f[first + 4], f[first + 5], atof(f[first + 6].c_str()),
+                  atof(f[first + 7].c_str()), atoi(f[first + 8].c_str()),
+                  atoi(f[first + 9].c_str()));
+        users.push_back(user);
+        userIndexById[user.getUserId()] = users.size() - 1;
+        nextUserId = max(nextUserId, user.getUserId() + 1);
+        return true;
+    }
+
+    static bool parseTransaction(const vector<string> &f, size_t first, Transaction &out)
+    {
+        DayNumber dueDay, returnDay = 0;
+        if (f.size() < first + 9 || !parseDay(f[first + 4], dueDay) ||
+            (f[first + 6] != "-" && !parseDay(f[first + 6], returnDay)))
+            return false;
+        out = Transaction(atoi(f[first].c_str()), atoi(f[first + 1].c_str()),
+                          atoi(f[first + 2].c_str()), time_t(atoll(f[first + 3].c_str())),
+                          dueDay, time_t(atoll(f[first + 5].c_str())), returnDay,
+                          f[first + 7], atof(f[first + 8].c_str()));
+        return true;
+    }
+
+    // Transactions are appended in ID order, so IDs can be binary searched
+    Transaction *findTransaction(int transactionId)
+    {
+        auto it = lower_bound(transactions.begin(), transactions.end(), transactionId,
+                              [](const Transaction &t, int id)
+                              { return t.getTransactionId() < id; });
+        return it != transactions.end() && it->getTransactionId() == transactionId ? &*it
+                                                                                   : nullptr;
+    }
+
+    bool replayIssue(const vector<string> &f, size_t first)
+    {
+        Transaction transaction(0, 0, 0, 0, 0);
+        if (!parseTransaction(f, first, transaction))
+            return false;
+        User *user = findUserById(transaction.getUserId());
+        long bookIndex = catalog.indexOf(transaction.getBookId());
+        if (!user || bookIndex < 0)
+            return false;
+        registerLoan(user, bookIndex, transaction);
+        nextTransactionId = max(nextTransactionId, transaction.getTransactionId() + 1);
+        return true;
+    }
+
+    bool replayReturn(const vector<string> &f, size_t first)
+    {
+        Transaction returned(0, 0, 0, 0, 0);
+        if (!parseTransaction(f, first, returned))
+            return false;
+        Transaction *transaction = findTransaction(returned.getTransactionId());
+        User *user = findUserById(returned.getUserId());
+        long bookIndex = catalog.indexOf(returned.getBookId());
+        if (!transaction || !user || bookIndex < 0)
+            return false;
+        *transaction = returned;
+        settleReturn(user, *transaction, bookIndex);
+        return true;
+    }
+
+    // One snapshot record (see saveSnapshot)
+    bool restoreSnapshotRecord(const vector<string> &f)
+    {
+        const string &type = f[0];
+        if (type == "SNAPSHOT")
+        {
+            clearState(); // the snapshot replaces the sample data
+            return true;
+        }
+        if (type == "NEXT_IDS" && f.size() >= 4)
+        {
+            nextBookId = atoi(f[1].c_str());
+            nextUserId = atoi(f[2].c_str());
+            nextTransactionId = atoi(f[3].c_str());
+            return true;
+        }
+        if (type == "BOOK")
+            return restoreBook(f, 1);
+        if (type == "USER")
+            return restoreUser(f, 1);
+        if (type == "CREDENTIAL" && f.size() >= 3)
+        {
+            userCredentials[f[1]] = atoi(f[2].c_str());
+            return true;
+        }
+        if (type == "TRANSACTION")
+        {
+            // Counts and balances are already in the book and user records
+            Transaction transaction(0, 0, 0, 0, 0);
+            if (!parseTransaction(f, 1, transaction))
+                return false;
+            User *user = findUserById(transaction.getUserId());
+            if (!user)
+                return false;
+            transactions.push_back(transaction);
+            if (transaction.getStatus() != "returned")
+                fineLedger.openLoan(transaction, user->getUserType());
+            indexBorrow(user, transaction.getBookId());
+            return true;
+        }
+        if (type == "FINE" && f.size() >= 6)
+        {
+            FineRecord record = {atoi(f[1].c_str()), atoi(f[2].c_str()), atoi(f[3].c_str()),
+                                 atof(f[4].c_str()), f[5]};
+            fineLedger.restoreFine(record);
+            return true;
+        }
+        if (type == "CALENDAR" && f.size() >= 2)
+        {
+            calendar.setClosedWeekdays(uint8_t(atoi(f[1].c_str())));
+            return true;
+        }
+        if (type == "CLOSURE" && f.size() >= 2)
+        {
+            DayNumber day;
+            if (!parseDay(f[1], day))
+                return false;
+            calendar.addClosure(day);
+            return true;
+        }
+        return false;
+    }
+
+    // One logged event (see the logEvent call sites)
+    bool replayEvent(const vector<string> &f)
+    {
+        const string &type = f[0];
+        if (type == "ADD_BOOK")
+            return restoreBook(f, 1);
+        if (type == "ADD_USER" && f.size() >= 2)
+        {
+            if (!restoreUser(f, 2))
+                return false;
+            userCredentials[f[1]] = users.back().getUserId();
+            return true;
+        }
+        if (type == "ISSUE")
+            return replayIssue(f, 1);
+        if (type == "RETURN")
+            return replayReturn(f, 1);
+        if ((type == "ISSUE_BATCH" || type == "RETURN_BATCH") && f.size() >= 2)
+        {
+            int count = atoi(f[1].c_str());
+            for (int i = 0; i < count; i++)
+            {
+                size_t first = 2 + size_t(i) * 9;
+                if (!(type == "ISSUE_BATCH" ? replayIssue(f, first) : replayReturn(f, first)))
+                    return false;
+            }
+            return true;
+        }
+        if (type == "FINE_PAYMENT" && f.size() >= 2)
+        {
+            fineLedger.payUnpaidFines(atoi(f[1].c_str()));
+            return true;
+        }
+        if (type == "CLOSURE" && f.size() >= 2)
+            return restoreSnapshotRecord(f);
+        if (type == "WEEKLY_CLOSED" && f.size() >= 2)
+        {
+            calendar.setClosedWeekdays(uint8_t(atoi(f[1].c_str())));
+            return true;
+        }
+        return false;
+    }
+
+public:
+    void logEvent(const string &record)
+    {
+        if (database)
+        {
+            database->appendLog(record);
+            reportPersistenceFailures();
+        }
+    }
+
+    // Warn once for each new batch of failed background writes
+    void reportPersistenceFailures()
+    {
+        uint64_t failedLogWrites = database->getFailedLogWrites();
+        uint64_t failedSnapshots = database->getFailedSnapshots();
+        if (failedLogWrites != reportedLogFailures)
+        {
+            cout << "Warning: " << (failedLogWrites - reportedLogFailures)
+                 << " event log write(s) failed; recent changes may not be saved." << endl;
+            reportedLogFailures = failedLogWrites;
+        }
+        if (failedSnapshots != reportedSnapshotFailures)
+        {
+            cout << "Warning: snapshot write failed." << endl;
+            reportedSnapshotFailures = failedSnapshots;
+        }
+    }
+
+    bool saveSnapshot()
+    {
+        if (!database)
+        {
+            cout << "Persistence is not enabled." << endl;
+            return false;
+        }
+
+        reportPersistenceFailures();
+        if (!database->beginSnapshot())
+        {
+            cout << "A snapshot is already being written. Try again later." << endl;
+            return false;
+        }
+
+        // Records are handed to the I/O threads chunk by chunk as they are
+        // serialized, so the whole state is never held as one string
+        database->addSnapshotRecord("NEXT_IDS\t" + to_string(nextBookId) + '\t' +
+                                    to_string(nextUserId) + '\t' +
+                                    to_string(nextTransactionId));
+        for (size_t i = 0; i < catalog.size(); i++)
+            database->addSnapshotRecord("BOOK\t" + catalog.get(i).toRecord());
+        for (const auto &user : users)
+            database->addSnapshotRecord("USER\t" + user.toRecord());
+        for (const auto &credential : userCredentials)
+            database->addSnapshotRecord("CREDENTIAL\t" + recordField(credential.first) +
+                                        '\t' + to_string(credential.second));
+        for (const auto &transaction : transactions)
+            database->addSnapshotRecord("TRANSACTION\t" + transaction.toRecord());
+        for (const auto &fine : fineLedger.allFines())
+            database->addSnapshotRecord("FINE\t" + to_string(fine.fineId) + '\t' +
+                                        to_string(fine.userId) + '\t' +
+                                        to_string(fine.transactionId) + '\t' +
+                                        to_string(fine.amount) + '\t' + fine.paymentStatus);
+        database->addSnapshotRecord("CALENDAR\t" +
+                                    to_string(int(calendar.getClosedWeekdays())));
+        for (DayNumber day : calendar.getClosures())
+            database->addSnapshotRecord("CLOSURE\t" + formatDay(day));
+        database->finishSnapshot();
+
+        cout << "Snapshot queued for writing." << endl;
+        return true;
+    }
+
+    // Book management methods
+    void addBook(const string &title, const string &author, const string &isbn,
+                 const string &genre, int copies, double price,
+                 const string &pubDate)
+    {
+        if (traceRecorder)
+            trace("ADD_BOOK", {title, author, isbn, genre, to_string(copies),
+                               to_string(price), pubDate});
+        Book newBook(nextBookId++, title, author, isbn, genre, copies, price, pubDate);
+        catalog.add(newBook);
+        autocomplete.addBook(newBook.getBookId(), title, author);
+        logEvent("ADD_BOOK\t" + newBook.toRecord());
+        cout << "Book added successfully with ID: " << (nextBookId - 1) << endl;
+    }
+
+    // Display one page of the catalog; only the rows on the page are
+    // materialized. Returns true if there are further pages.
+    bool displayBooksPage(size_t page, size_t pageSize) const
+    {
+        ScopedOpTimer timer(metrics, OP_REPORT_CATALOG);
+        if (traceRecorder)
+            trace("REPORT", {"catalog", to_string(page)});
+        if (catalog.empty())
+        {
+            cout << "No books available in the library." << endl;
+            return false;
+        }
+
+        size_t first = page * pageSize;
+        if (pageSize == 0 || first >= catalog.size())
+        {
+            cout << "No books on this page." << endl;
+            return false;
+        }
+
+        size_t last = min(first + pageSize, catalog.size());
+        cout << "\n=== LIBRARY CATALOG (books " << (first + 1) << "-" << last
+             << " of " << catalog.size() << ") ===" << endl;
+        for (size_t i = first; i < last; i++)
+        {
+            cout << "\n------------------------" << endl;
+            catalog.get(i).displayInfo();
+        }
+        return last < catalog.size();
+    }
+
+    void browseCatalog()
+    {
+        // Browsing is open to guests; a signed-in user stops paging once
+        // their session expires
+        bool signedIn = isLoggedIn();
+        size_t page = 0;
+        while (displayBooksPage(page, catalogPageSize))
+        {
+            string next;
+            cout << "\nEnter n for the next page, anything else to return: ";
+            cin >> next;
+            tick();
+            if (signedIn && !refreshConsoleSession())
+                return;
+            if (next != "n" && next != "N")
+                break;
+            page++;
+        }
+    }
+
+    vector<Book> searchBooks(const string &searchTerm, const string &searchType)
+    {
+        ScopedOpTimer timer(metrics, searchOpFor(searchType));
+        if (traceRecorder)
+            trace("SEARCH", {searchType, searchTerm});
+        vector<Book> results;
+        string lowerSearchTerm = searchTerm;
+        transform(lowerSearchTerm.begin(), lowerSearchTerm.end(),
+                  lowerSearchTerm.begin(), ::tolower);
+
+        // Genres are interned, so match each distinct genre name once and
+        // then scan only the hot table
+        vector<bool> genreMatches;
+        if (searchType == "genre")
+        {
+            for (string lowerGenre : catalog.genreNames())
+            {
+                transform(lowerGenre.begin(), lowerGenre.end(),
+                          lowerGenre.begin(), ::tolower);
+                genreMatches.push_back(lowerGenre.find(lowerSearchTerm) != string::npos);
+            }
+        }
+
+        for (size_t i = 0; i < catalog.size(); i++)
+        {
+            bool match = false;
+
+            if (searchType == "title")
+            {
+                string lowerTitle = catalog.getTitle(i);
+                transform(lowerTitle.begin(), lowerTitle.end(),
+                          lowerTitle.begin(), ::tolower);
+                match = lowerTitle.find(lowerSearchTerm) != string::npos;
+            }
+            else if (searchType == "author")
+            {
+                string lowerAuthor = catalog.getAuthor(i);
+                transform(lowerAuthor.begin(), lowerAuthor.end(),
+                          lowerAuthor.begin(), ::tolower);
+                match = lowerAuthor.find(lowerSearchTerm) != string::npos;
+            }
+            else if (searchType == "isbn")
+            {
+                match = catalog.isbnEquals(i, searchTerm);
+            }
+            else if (searchType == "genre")
+            {
+                match = genreMatches[catalog.hotAt(i).genreId];
+            }
+
+            if (match)
+            {
+                results.push_back(catalog.get(i));
+            }
+        }
+
+        return results;
+    }
+
+    // Title/author completions for a partially typed query
+    vector<int> suggestBooks(const string &prefix, size_t limit = 10) const
+    {
+        ScopedOpTimer timer(metrics, OP_AUTOCOMPLETE);
+        if (traceRecorder)
+            trace("SEARCH", {"suggest", prefix});
+        return autocomplete.complete(prefix, limit);
+    }
+
+    // User management methods
+    void addUser(const string &username, const string &name, const string &email,
+                 const string &phone, const string &userType,
+                 const string &password, int maxBooks = 5)
+    {
+        if (traceRecorder)
+            trace("ADD_USER", {username, name, email, phone, userType, password,
+                               to_string(maxBooks)});
+        User newUser(nextUserId++, name, email, phone, userType, password, maxBooks);
+        users.push_back(newUser);
+        userCredentials[username] = nextUserId - 1;
+        userIndexById[nextUserId - 1] = users.size() - 1;
+        logEvent("ADD_USER\t" + recordField(username) + '\t' + newUser.toRecord());
+        cout << "User registered successfully with ID: " << (nextUserId - 1) << endl;
+    }
+
+    User *findUserById(int userId)
+    {
+        auto it = userIndexById.find(userId);
+        return it != userIndexById.end() ? &users[it->second] : nullptr;
+    }
+
+    // Session methods
+
+    // Authenticate and open a session; returns its token, or an empty
+    // string if the credentials are wrong
+    string openSession(const string &username, const string &password)
+    {
+        ScopedOpTimer timer(metrics, OP_LOGIN);
+        auto it = userCredentials.find(username);
+        if (it != userCredentials.end())
+        {
+            User *user = findUserById(it->second);
+            if (user && user->verifyPassword(password))
+            {
+                return sessions.create(user->getUserId(), clock->now());
+            }
+        }
+        timer.fail();
+        return "";
+    }
+
+    // The user behind a live session token, or nullptr
+    User *resolveSession(const string &token)
+    {
+        int userId = sessions.resolve(token, clock->now());
+        return userId < 0 ? nullptr : findUserById(userId);
+    }
+
+    void closeSession(const string &token)
+    {
+        sessions.destroy(token);
+    }
+
+    long activeSessionCount() const { return sessions.size(); }
+
+    bool login(const string &username, const string &password)
+    {
+        if (traceRecorder)
+            trace("LOGIN", {username, password});
+        string token = openSession(username, password);
+        User *user = token.empty() ? nullptr : resolveSession(token);
+        if (user)
+        {
+            currentToken = token;
+            currentUser = user;
+            cout << "Login successful! Welcome, " << user->getName() << endl;
+            return true;
+        }
+        cout << "Invalid username or password." << endl;
+        return false;
+    }
+
+    void logout()
+    {
+        if (currentUser)
+        {
+            if (traceRecorder)
+                trace("LOGOUT", {});
+            cout << "Goodbye, " << currentUser->getName() << "!" << endl;
+            closeSession(currentToken);
+            currentToken.clear();
+            currentUser = nullptr;
+        }
+    }
+
+    bool isLoggedIn() const
+    {
+        return currentUser != nullptr;
+    }
+
+    // Re-check the console session, refreshing its idle timer. Called
+    // after each blocking read so an action never runs on a session that
+    // expired while waiting for input.
+    bool refreshConsoleSession()
+    {
+        if (!currentUser)
+            return false;
+
+        currentUser = resolveSession(currentToken);
+        if (!currentUser)
+        {
+            cout << "Your session has expired. Please login again." << endl;
+            currentToken.clear();
+            return false;
+        }
+        return true;
+    }
+
+    // Transaction methods
+    // Record a checkout of an available book for user. Callers
+    // have already validated the user and the book.
+    const Transaction &applyIssue(User *user, long bookIndex, int bookId)
+    {
+        DayNumber dueDay = calendar.addOpenDays(clock->today(), loanPeriodDays);
+        registerLoan(user, bookIndex, Transaction(nextTransactionId++, user->getUserId(),
+                                                  bookId, clock->now(), dueDay));
+        return transactions.back();
+    }
+
+    // Book-keeping shared by a checkout and the replay of a logged one
+    void registerLoan(User *user, long bookIndex, const Transaction &transaction)
+    {
+        catalog.issueCopy(bookIndex);
+        transactions.push_back(transaction);
+        fineLedger.openLoan(transaction, user->getUserType());
+        indexBorrow(user, transaction.getBookId());
+        user->incrementBorrowedBooks();
+    }
+
+    // Borrowing history, co-borrow pairs and autocomplete popularity
+    void indexBorrow(User *user, int bookId)
+    {
+        coBorrowIndex.recordBorrow(user->getBorrowingHistory(), bookId);
+        user->addToHistory(bookId);
+        long bookIndex = catalog.indexOf(bookId);
+        autocomplete.recordLoan(bookId, catalog.getTitle(bookIndex),
+                                catalog.getAuthor(bookIndex));
+    }
+
+    void applyReturn(User *user, Transaction &transaction, long bookIndex)
+    {
+        FineRate rate = fineLedger.rateFor(user->getUserType());
+        transaction.returnBook(clock->now(), clock->today(), rate.dailyRate, rate.maxFine);
+        settleReturn(user, transaction, bookIndex);
+    }
+
+    // Book-keeping shared by a return and the replay of a logged one; the
+    // transaction already holds its final state
+    void settleReturn(User *user, const Transaction &transaction, long bookIndex)
+    {
+        catalog.returnCopy(bookIndex);
+        fineLedger.closeLoan(transaction);
+        user->decrementBorrowedBooks();
+    }
+
+    bool issueBook(User *user, int bookId)
+    {
+        ScopedOpTimer timer(metrics, OP_ISSUE_BOOK);
+        if (traceRecorder)
+            trace("ISSUE", {to_string(bookId)});
+        if (!user)
+        {
+            cout << "Please login first." << endl;
+            timer.fail();
+            return false;
+        }
+
+        if (!user->canBorrowMore())
+        {
+            cout << "You have reached your borrowing limit." << endl;
+            timer.fail();
+            return false;
+        }
+
+        accrueFinesIfDue();
+        if (user->getOutstandingFines() >= fineBlockThreshold)
+        {
+            cout << "You have $" << user->getOutstandingFines()
+                 << " in outstanding fines. Please pay them before borrowing." << endl;
+            timer.fail();
+            return false;
+        }
+
+        // Find the book
+        long bookIndex = catalog.indexOf(bookId);
+        if (bookIndex < 0)
+        {
+            cout << "Book not found." << endl;
+            timer.fail();
+            return false;
+        }
+
+        if (!catalog.isAvailable(bookIndex))
+        {
+            cout << "Book is not available for checkout." << endl;
+            timer.fail();
+            return false;
+        }
+
+        // Issue the book
+        if (catalog.isAvailable(bookIndex))
+        {
+            const Transaction &newTransaction = applyIssue(user, bookIndex, bookId);
+            logEvent("ISSUE\t" + newTransaction.toRecord());
+
+            cout << "Book issued successfully!" << endl;
+            cout << "Transaction ID: " << (nextTransactionId - 1) << endl;
+            cout << "Due Date: " << formatDay(newTransaction.getDueDay()) << endl;
+            displayRecommendations(bookId);
+
+            return true;
+        }
+
+        timer.fail();
+        return false;
+    }
+
+    bool returnBook(User *user, int bookId)
+    {
+        ScopedOpTimer timer(metrics, OP_RETURN_BOOK);
+        if (traceRecorder)
+            trace("RETURN", {to_string(bookId)});
+        if (!user)
+        {
+            cout << "Please login first." << endl;
+            timer.fail();
+            return false;
+        }
+
+        // Find the transaction
+        Transaction *transactionToReturn = nullptr;
+        for (auto &transaction : transactions)
+        {
+            if (transaction.getUserId() == user->getUserId() &&
+                transaction.getBookId() == bookId &&
+                transaction.getStatus() != "returned")
+            {
+                transactionToReturn = &transaction;
+                break;
+            }
+        }
+
+        if (!transactionToReturn)
+        {
+            cout << "No active transaction found for this book." << endl;
+            timer.fail();
+            return false;
+        }
+
+        // Find the book and return it
+        long bookIndex = catalog.indexOf(bookId);
+        if (bookIndex >= 0)
+        {
+            applyReturn(user, *transactionToReturn, bookIndex);
+            logEvent("RETURN\t" + transactionToReturn->toRecord());
+
+            cout << "Book returned successfully!" << endl;
+
+            // Check for fines
+            if (transactionToReturn->getFineAmount() > 0)
+            {
+                cout << "Fine Amount: $" << transactionToReturn->getFineAmount() << endl;
+                cout << "Please pay the fine at the library counter." << endl;
+            }
+
+            return true;
+        }
+
+        timer.fail();
+        return false;
+    }
+
+    // Batch circulation methods
+
+    // Check out a stack of books in one call. The user, borrowing limit and
+    // fines are checked once and every item is validated before anything is
+    // applied. With allOrNothing, a single rejected item rejects the batch;
+    // otherwise valid items are issued (in order, up to the borrowing limit)
+    // and the rest are reported. One log record covers the whole batch.
+    vector<BatchItemResult> issueBooks(User *user, const vector<int> &bookIds,
+                                       bool allOrNothing)
+    {
+        ScopedOpTimer timer(metrics, OP_ISSUE_BATCH);
+        if (traceRecorder)
+        {
+            vector<string> traceArgs;
+            for (int bookId : bookIds)
+                traceArgs.push_back(to_string(bookId));
+            trace("ISSUE_BATCH", traceArgs);
+        }
+        vector<BatchItemResult> results;
+        string batchError;
+
+        if (!user)
+        {
+            batchError = "Please login first.";
+        }
+        else
+        {
+            accrueFinesIfDue();
+            if (user->getOutstandingFines() >= fineBlockThreshold)
+                batchError = "Outstanding fines must be paid before borrowing.";
+        }
+
+        if (!batchError.empty())
+        {
+            for (int bookId : bookIds)
+            {
+                BatchItemResult result = {bookId, false, batchError};
+                results.push_back(result);
+            }
+            timer.fail();
+            return results;
+        }
+
+        // Validation pass
+        int slotsLeft = user->getMaxBooksAllowed() - user->getBorrowedBooks();
+        unordered_set<int> seen;
+        vector<long> bookIndexes;
+        bool anyRejected = false;
+
+        for (int bookId : bookIds)
+        {
+            BatchItemResult result = {bookId, false, ""};
+            long bookIndex = catalog.indexOf(bookId);
+
+            if (!seen.insert(bookId).second)
+                result.message = "Duplicate item in batch.";
+            else if (bookIndex < 0)
+                result.message = "Book not found.";
+            else if (!catalog.isAvailable(bookIndex))
+                result.message = "Book is not available for checkout.";
+            else if (slotsLeft <= 0)
+                result.message = "Borrowing limit reached.";
+            else
+            {
+                result.success = true;
+                slotsLeft--;
+            }
+
+            anyRejected = anyRejected || !result.success;
+            results.push_back(result);
+            bookIndexes.push_back(bookIndex);
+        }
+
+        if (allOrNothing && anyRejected)
+        {
+            for (auto &result : results)
+            {
+                if (result.success)
+                {
+                    result.success = false;
+                    result.message = "Batch rejected; nothing was issued.";
+                }
+            }
+            timer.fail();
+            return results;
+        }
+
+        // Apply pass
+        string batchRecord;
+        int issued = 0;
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            if (!results[i].success)
+                continue;
+
+            const Transaction &newTransaction = applyIssue(user, bookIndexes[i], results[i].bookId);
+            results[i].message = "Issued, transaction " +
+                                 to_string(newTransaction.getTransactionId());
+            batchRecord += '\t' + newTransaction.toRecord();
+            issued++;
+        }
+
+        if (issued > 0)
+        {
+            logEvent("ISSUE_BATCH\t" + to_string(issued) + batchRecord);
+        }
+        else
+        {
+            timer.fail();
+        }
+        return results;
+    }
+
+    // Return a stack of books. The user's open loans are indexed in one
+    // pass over the transactions instead of one scan per item.
+    vector<BatchItemResult> returnBooks(User *user, const vector<int> &bookIds)
+    {
+        ScopedOpTimer timer(metrics, OP_RETURN_BATCH);
+        if (traceRecorder)
+        {
+            vector<string> traceArgs;
+            for (int bookId : bookIds)
+                traceArgs.push_back(to_string(bookId));
+            trace("RETURN_BATCH", traceArgs);
+        }
+        vector<BatchItemResult> results;
+
+        if (!user)
+        {
+            for (int bookId : bookIds)
+            {
+                BatchItemResult result = {bookId, false, "Please login first."};
+                results.push_back(result);
+            }
+            timer.fail();
+            return results;
+        }
+
+        // bookId -> open loans, oldest first; a patron may hold several
+        // copies of one book, and each occurrence in the batch returns one
+        unordered_map<int, deque<Transaction *>> openLoans;
+        for (auto &transaction : transactions)
+        {
+            if (transaction.getUserId() == user->getUserId() &&
+                transaction.getStatus() != "returned")
+            {
+                openLoans[transaction.getBookId()].push_back(&transaction);
+            }
+        }
+
+        string batchRecord;
+        int returned = 0;
+        double totalFine = 0.0;
+        for (int bookId : bookIds)
+        {
+            BatchItemResult result = {bookId, false, ""};
+            auto loan = openLoans.find(bookId);
+            long bookIndex = catalog.indexOf(bookId);
+
+            if (loan == openLoans.end() || loan->second.empty() || bookIndex < 0)
+            {
+                result.message = "No active transaction found for this book.";
+            }
+            else
+            {
+                Transaction &transaction = *loan->second.front();
+                loan->second.pop_front();
+                applyReturn(user, transaction, bookIndex);
+
+                result.success = true;
+                result.message = "Returned";
+                if (transaction.getFineAmount() > 0)
+                {
+                    result.message += ", fine $" + to_string(transaction.getFineAmount());
+                    totalFine += transaction.getFineAmount();
+                }
+                batchRecord += '\t' + transaction.toRecord();
+                returned++;
+            }
+            results.push_back(result);
+        }
+
+        if (returned > 0)
+        {
+            logEvent("RETURN_BATCH\t" + to_string(returned) + batchRecord);
+        }
+        else
+        {
+            timer.fail();
+        }
+
+        if (totalFine > 0)
+        {
+            cout << "Total fines for this batch: $" << totalFine << endl;
+            cout << "Please pay the fine at the library counter." << endl;
+        }
+        return results;
+    }
+
+    // Token-based API: the caller is resolved from its session token on
+    // every call and passed down explicitly, so concurrent callers never
+    // share caller state. Library data itself is not internally locked;
+    // callers running several threads serialize these calls.
+    bool issueBook(const string &token, int bookId)
+    {
+        return issueBook(resolveSession(token), bookId);
+    }
+
+    bool returnBook(const string &token, int bookId)
+    {
+        return returnBook(resolveSession(token), bookId);
+    }
+
+    vector<BatchItemResult> issueBooks(const string &token, const vector<int> &bookIds,
+                                       bool allOrNothing)
+    {
+        return issueBooks(resolveSession(token), bookIds, allOrNothing);
+    }
+
+    vector<BatchItemResult> returnBooks(const string &token, const vector<int> &bookIds)
+    {
+        return returnBooks(resolveSession(token), bookIds);
+    }
+
+    // Run a named report as the caller identified by token; the catalog
+    // report takes an optional page number
+    bool runReport(const string &token, const string &report, const string &arg = "")
+    {
+        const User *viewer = resolveSession(token);
+        if (report == "catalog")
+            displayBooksPage(size_t(atol(arg.c_str())), catalogPageSize);
+        else if (report == "transactions")
+            displayUserTransactions(viewer);
+        else if (report == "overdue")
+            displayOverdueBooks(viewer);
+        else if (report == "users")
+            displayAllUsers(viewer);
+        else if (report == "fines")
+            displayOutstandingFines(viewer);
+        else if (report == "inventory")
+            displayInventoryReport(viewer);
+        else
+            return false;
+        return viewer != nullptr;
+    }
+
+    void displayBatchResults(const vector<BatchItemResult> &results) const
+    {
+        int succeeded = 0;
+        for (const auto &result : results)
+        {
+            cout << "  [" << result.bookId << "] "
+                 << (result.success ? "OK: " : "FAILED: ") << result.message << endl;
+            if (result.success)
+                succeeded++;
+        }
+        cout << succeeded << " of " << results.size() << " items processed." << endl;
+    }
+
+    // Recommendation methods
+    void displayRecommendations(int bookId, size_t limit = 3) const
+    {
+        vector<int> related = coBorrowIndex.recommend(bookId, limit);
+        if (related.empty())
+            return;
+
+        cout << "Patrons who borrowed this also borrowed:" << endl;
+        for (int relatedId : related)
+        {
+            long bookIndex = catalog.indexOf(relatedId);
+            if (bookIndex >= 0)
+            {
+                cout << "  [" << relatedId << "] " << catalog.getTitle(bookIndex)
+                     << " by " << catalog.getAuthor(bookIndex) << endl;
+            }
+        }
+    }
+
+    // Rebuild the co-borrowing index from the full transaction history
+    void rebuildRecommendations()
+    {
+        vector<vector<int>> histories;
+        unordered_map<int, size_t> historyIndex;
+        for (const auto &transaction : transactions)
+        {
+            auto it = historyIndex.find(transaction.getUserId());
+            if (it == historyIndex.end())
+            {
+                it = historyIndex.insert(make_pair(transaction.getUserId(),
+                                                   histories.size())).first;
+                histories.push_back(vector<int>());
+            }
+            histories[it->second].push_back(transaction.getBookId());
+        }
+
+        int threads = int(thread::hardware_concurrency());
+        coBorrowIndex.rebuild(histories, threads > 0 ? threads : 1);
+        cout << "Recommendations rebuilt from " << transactions.size()
+             << " transactions." << endl;
+    }
+
+    // Fine accrual runs at most once per calendar day
+    void accrueFinesIfDue()
+    {
+        DayNumber today = clock->today();
+        if (today != lastFineAccrualDay)
+        {
+            fineLedger.accrue(today);
+            lastFineAccrualDay = today;
+        }
+    }
+
+    void handleAddClosure()
+    {
+        if (!currentUser || (currentUser->getUserType() != "admin" &&
+                             currentUser->getUserType() != "librarian"))
+        {
+            cout << "Access denied. Admin/Librarian privileges required." << endl;
+            return;
+        }
+
+        string date;
+        DayNumber day;
+        cout << "Enter closure date (YYYY-MM-DD): ";
+        cin >> date;
+        tick();
+        if (!refreshConsoleSession())
+            return;
+
+        if (!parseDay(date, day))
+        {
+            cout << "Invalid date." << endl;
+            return;
+        }
+        calendar.addClosure(day);
+        logEvent("CLOSURE\t" + formatDay(day));
+        cout << "Library closed on " << formatDay(day)
+             << "; new loans will not count it toward the loan period." << endl;
+    }
+
+    void handleWeeklyClosures()
+    {
+        static const char *weekdayNames[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+        if (!currentUser || (currentUser->getUserType() != "admin" &&
+                             currentUser->getUserType() != "librarian"))
+        {
+            cout << "Access denied. Admin/Librarian privileges required." << endl;
+            return;
+        }
+
+        string line;
+        cout << "Enter closed weekdays (0=Sun ... 6=Sat, e.g. 0 6), or none: ";
+        cin >> ws;
+        getline(cin, line);
+        tick();
+        if (!refreshConsoleSession())
+            return;
+
+        bool closed[7] = {false, false, false, false, false, false, false};
+        if (line != "none")
+        {
+            istringstream in(line);
+            string field;
+            while (in >> field)
+            {
+                if (field.size() != 1 || field[0] < '0' || field[0] > '6')
+                {
+                    cout << "Invalid weekday: " << field << endl;
+                    return;
+                }
+                closed[field[0] - '0'] = true;
+            }
+        }
+
+        cout << "Closed every:";
+        bool any = false;
+        for (int weekday = 0; weekday < 7; weekday++)
+        {
+            calendar.setWeekdayClosed(weekday, closed[weekday]);
+            if (calendar.isWeekdayClosed(weekday))
+            {
+                cout << " " << weekdayNames[weekday];
+                any = true;
+            }
+        }
+        cout << (any ? "" : " (none)") << endl;
+        logEvent("WEEKLY_CLOSED\t" + to_string(int(calendar.getClosedWeekdays())));
+    }
+
+    // Reporting methods
+
+    // Fine owed on a transaction: final once returned, accrued so far
+    // (as of the last daily accrual) while the loan is open
+    double fineDueOn(const Transaction &transaction) const
+    {
+        if (transaction.getStatus() == "returned")
+            return transaction.getFineAmount();
+        return fineLedger.accruedFine(transaction.getTransactionId());
+    }
+
+    void displayUserTransactions(const User *viewer) const
+    {
+        ScopedOpTimer timer(metrics, OP_REPORT_USER_TRANSACTIONS);
+        if (traceRecorder)
+            trace("REPORT", {"transactions"});
+        if (!viewer)
+        {
+            cout << "Please login first." << endl;
+            timer.fail();
+            return;
+        }
+
+        cout << "\n=== YOUR TRANSACTIONS ===" << endl;
+        bool hasTransactions = false;
+
+        for (const auto &transaction : transactions)
+        {
+            if (transaction.getUserId() == viewer->getUserId())
+            {
+                cout << "\n------------------------" << endl;
+                transaction.displayInfo(fineDueOn(transaction));
+
+                // Display book details
+                long bookIndex = catalog.indexOf(transaction.getBookId());
+                if (bookIndex >= 0)
+                {
+                    cout << "Book: " << catalog.getTitle(bookIndex)
+                         << " by " << catalog.getAuthor(bookIndex) << endl;
+                }
+                hasTransactions = true;
+            }
+        }
+
+        if (!hasTransactions)
+        {
+            cout << "No transactions found." << endl;
+        }
+    }
+
+    void displayAccount() const
+    {
+        if (!currentUser)
+        {
+            cout << "Please login first." << endl;
+            return;
+        }
+
+        currentUser->displayInfo();
+
+        vector<FineRecord> fines = fineLedger.finesForUser(currentUser->getUserId());
+        if (!fines.empty())
+        {
+            cout << "\n=== YOUR FINES ===" << endl;
+            for (const auto &fine : fines)
+            {
+                cout << "Fine " << fine.fineId << " (Transaction "
+                     << fine.transactionId << "): $" << fine.amount
+                     << " [" << fine.paymentStatus << "]" << endl;
+            }
+        }
+    }
+
+    void displayOutstandingFines(const User *viewer) const
+    {
+        ScopedOpTimer timer(metrics, OP_REPORT_FINES);
+        if (traceRecorder)
+            trace("REPORT", {"fines"});
+        if (!viewer || (viewer->getUserType() != "admin" &&
+                             viewer->getUserType() != "librarian"))
+        {
+            cout << "Access denied. Admin/Librarian privileges required." << endl;
+            timer.fail();
+            return;
+        }
+
+        cout << "\n=== OUTSTANDING FINES ===" << endl;
+        bool hasFines = false;
+        double total = 0.0;
+
+        for (const auto &user : users)
+        {
+            if (user.getOutstandingFines() > 0)
+            {
+                cout << user.getUserId() << " " << user.getName()
+                     << ": $" << user.getOutstandingFines() << endl;
+                total += user.getOutstandingFines();
+                hasFines = true;
+            }
+        }
+
+        if (!hasFines)
+        {
+            cout << "No outstanding fines." << endl;
+        }
+        else
+        {
+            cout << "Total outstanding: $" << total << endl;
+        }
+    }
+
+    // Inventory totals per genre, computed from the hot table only
+    void displayInventoryReport(const User *viewer) const
+    {
+        ScopedOpTimer timer(metrics, OP_REPORT_INVENTORY);
+        if (traceRecorder)
+            trace("REPORT", {"inventory"});
+        if (!viewer || (viewer->getUserType() != "admin" &&
+                             viewer->getUserType() != "librarian"))
+        {
+            cout << "Access denied. Admin/Librarian privileges required." << endl;
+            timer.fail();
+            return;
+        }
+
+        const vector<string> &genres = catalog.genreNames();
+        vector<long> titles(genres.size(), 0);
+        vector<long> totalCopies(genres.size(), 0);
+        vector<long> availableCopies(genres.size(), 0);
+
+        for (const auto &row : catalog.hotRows())
+        {
+            titles[row.genreId]++;
+            totalCopies[row.genreId] += row.totalCopies;
+            availableCopies[row.genreId] += row.availableCopies;
+        }
+
+        cout << "\n=== INVENTORY REPORT ===" << endl;
+        long allTotal = 0, allAvailable = 0;
+        for (size_t g = 0; g < genres.size(); g++)
+        {
+            cout << genres[g] << ": " << titles[g] << " titles, "
+                 << availableCopies[g] << "/" << totalCopies[g]
+                 << " copies available" << endl;
+            allTotal += totalCopies[g];
+            allAvailable += availableCopies[g];
+        }
+        cout << "Total: " << catalog.size() << " titles, " << allAvailable << "/"
+             << allTotal << " copies available, "
+             << (allTotal - allAvailable) << " on loan" << endl;
+        cout << "Catalog memory: " << catalog.memoryUsage() << " bytes" << endl;
+    }
+
+    void handleFinePayment()
+    {
+        if (!currentUser || (currentUser->getUserType() != "admin" &&
+                             currentUser->getUserType() != "librarian"))
+        {
+            cout << "Access denied. Admin/Librarian privileges required." << endl;
+            return;
+        }
+
+        int userId;
+        cout << "Enter User ID paying fines: ";
+        cin >> userId;
+        tick();
+        if (!refreshConsoleSession())
+            return;
+
+        if (!findUserById(userId))
+        {
+            cout << "User not found." << endl;
+            return;
+        }
+
+        double paid = fineLedger.payUnpaidFines(userId);
+        if (paid > 0)
+        {
+            logEvent("FINE_PAYMENT\t" + to_string(userId) + '\t' + to_string(paid));
+            cout << "Recorded payment of $" << paid << endl;
+        }
+        else
+        {
+            cout << "No unpaid fines on returned books for this user." << endl;
+        }
+    }
+
+    void displayOverdueBooks(const User *viewer) const
+    {
+        ScopedOpTimer timer(metrics, OP_REPORT_OVERDUE);
+        if (traceRecorder)
+            trace("REPORT", {"overdue"});
+        if (!viewer || (viewer->getUserType() != "admin" &&
+                             viewer->getUserType() != "librarian"))
+        {
+            cout << "Access denied. Admin/Librarian privileges required." << endl;
+            timer.fail();
+            return;
+        }
+
+        cout << "\n=== OVERDUE BOOKS ===" << endl;
+        bool hasOverdue = false;
+        DayNumber today = clock->today();
+
+        for (const auto &transaction : transactions)
+        {
+            if (transaction.isOverdue(today))
+            {
+                cout << "\n------------------------" << endl;
+                transaction.displayInfo(fineDueOn(transaction));
+
+                // Display user and book details
+                for (const auto &user : users)
+                {
+                    if (user.getUserId() == transaction.getUserId())
+                    {
+                        cout << "User: " << user.getName()
+                             << " (" << user.getEmail() << ")" << endl;
+                        break;
+                    }
+                }
+
+                long bookIndex = catalog.indexOf(transaction.getBookId());
+                if (bookIndex >= 0)
+                {
+                    cout << "Book: " << catalog.getTitle(bookIndex)
+                         << " by " << catalog.getAuthor(bookIndex) << endl;
+                }
+                hasOverdue = true;
+            }
+        }
+
+        if (!hasOverdue)
+        {
+            cout << "No overdue books found." << endl;
+        }
+    }
+
+    // Main menu system
+    void showMainMenu()
+    {
+        cout << "\n=== LIBRARY MANAGEMENT SYSTEM ===" << endl;
+        cout << "1. Login" << endl;
+        cout << "2. Register New User" << endl;
+        cout << "3. View All Books" << endl;
+        cout << "4. Search Books" << endl;
+        cout << "0. Exit" << endl;
+        cout << "Choose an option: ";
+    }
+
+    void showUserMenu()
+    {
+        cout << "\n=== USER MENU ===" << endl;
+        cout << "Current User: " << currentUser->getName()
+             << " (" << currentUser->getUserType() << ")" << endl;
+        cout << "1. View All Books" << endl;
+        cout << "2. Search Books" << endl;
+        cout << "3. Issue Book" << endl;
+        cout << "4. Return Book" << endl;
+        cout << "5. View My Transactions" << endl;
+        cout << "6. View My Account" << endl;
+
+        if (currentUser->getUserType() == "admin" ||
+            currentUser->getUserType() == "librarian")
+        {
+            cout << "7. Add New Book" << endl;
+            cout << "8. View Overdue Books" << endl;
+            cout << "9. View All Users" << endl;
+            cout << "10. Export Metrics" << endl;
+            cout << "11. View Outstanding Fines" << endl;
+            cout << "12. Record Fine Payment" << endl;
+            cout << "13. Inventory Report" << endl;
+            cout << "14. Save Snapshot" << endl;
+            cout << "15. Rebuild Recommendations" << endl;
+            cout << "16. Add Closure Day" << endl;
+            cout << "17. Set Weekly Closed Days" << endl;
+        }
+
+        cout << "0. Logout" << endl;
+        cout << "Choose an option: ";
+    }
+
+    void handleUserRegistration()
+    {
+        string username, name, email, phone, userType, password;
+
+        cout << "Enter username: ";
+        cin >> username;
+
+        // Check if username already exists
+        if (userCredentials.find(username) != userCredentials.end())
+        {
+            cout << "Username already exists. Please choose a different username." << endl;
+            return;
+        }
+
+        cin.ignore(); // Clear input buffer
+        cout << "Enter full name: ";
+        getline(cin, name);
+
+        cout << "Enter email: ";
+        cin >> email;
+
+        cout << "Enter phone: ";
+        cin >> phone;
+
+        cout << "Enter user type (student/faculty): ";
+        cin >> userType;
+
+        cout << "Enter password: ";
+        cin >> password;
+
+        int maxBooks = (userType == "faculty") ? 10 : 5;
+        addUser(username, name, email, phone, userType, password, maxBooks);
+    }
+
+    void handleBookSearch()
+    {
+        string searchTerm, searchType;
+        bool signedIn = isLoggedIn();
+
+        cout << "Search by (title/author/isbn/genre/suggest): ";
+        cin >> searchType;
+
+        cin.ignore(); // Clear input buffer
+        cout << "Enter search term: ";
+        getline(cin, searchTerm);
+        tick();
+        if (signedIn && !refreshConsoleSession())
+            return;
+
+        if (searchType == "suggest")
+        {
+            vector<int> suggestions = suggestBooks(searchTerm);
+            if (suggestions.empty())
+            {
+                cout << "No suggestions found." << endl;
+                return;
+            }
+
+            cout << "\n=== SUGGESTIONS ===" << endl;
+            for (int bookId : suggestions)
+            {
+                long bookIndex = catalog.indexOf(bookId);
+                cout << "[" << bookId << "] " << catalog.getTitle(bookIndex)
+                     << " by " << catalog.getAuthor(bookIndex) << endl;
+            }
+            return;
+        }
+
+        vector<Book> results = searchBooks(searchTerm, searchType);
+
+        if (results.empty())
+        {
+            cout << "No books found matching your search." << endl;
+        }
+        else
+        {
+            cout << "\n=== SEARCH RESULTS ===" << endl;
+            for (const auto &book : results)
+            {
+                cout << "\n------------------------" << endl;
+                book.displayInfo();
+            }
+        }
+    }
+
+    // Reads one line of whitespace-separated book IDs
+    vector<int> readBookIds()
+    {
+        string line;
+        cin >> ws;
+        getline(cin, line);
+
+        vector<int> bookIds;
+        istringstream in(line);
+        int bookId;
+        while (in >> bookId)
+        {
+            bookIds.push_back(bookId);
+        }
+        return bookIds;
+    }
+
+    void handleBookIssue()
+    {
+        cout << "Enter Book ID(s) to issue: ";
+        vector<int> bookIds = readBookIds();
+        tick();
+        if (!refreshConsoleSession())
+            return;
+        if (bookIds.size() == 1)
+        {
+            issueBook(currentUser, bookIds[0]);
+        }
+        else if (!bookIds.empty())
+        {
+            displayBatchResults(issueBooks(currentUser, bookIds, false));
+        }
+    }
+
+    void handleBookReturn()
+    {
+        cout << "Enter Book ID(s) to return: ";
+        vector<int> bookIds = readBookIds();
+        tick();
+        if (!refreshConsoleSession())
+            return;
+        if (bookIds.size() == 1)
+        {
+            returnBook(currentUser, bookIds[0]);
+        }
+        else if (!bookIds.empty())
+        {
+            displayBatchResults(returnBooks(currentUser, bookIds));
+        }
+    }
+
+    void handleDynamicAddBook()
+    {
+        if (!currentUser || (currentUser->getUserType() != "admin" &&
+                             currentUser->getUserType() != "librarian"))
+        {
+            cout << "Access denied. Admin/Librarian privileges required." << endl;
+            return;
+        }
+
+        string title, author, isbn, genre, pubDate;
+        int copies;
+        double price;
+
+        cin.ignore(); // Clear input buffer
+        cout << "Enter book title: ";
+        getline(cin, title);
+
+        cout << "Enter author name: ";
+        getline(cin, author);
+
+        cout << "Enter ISBN: ";
+        cin >> isbn;
+
+        cout << "Enter genre: ";
+        cin >> genre;
+
+        cout << "Enter number of copies: ";
+        cin >> copies;
+
+        cout << "Enter price: $";
+        cin >> price;
+
+        cout << "Enter publication date (YYYY-MM-DD): ";
+        cin >> pubDate;
+
+        tick();
+        if (!refreshConsoleSession())
+            return;
+        addBook(title, author, isbn, genre, copies, price, pubDate);
+    }
+
+    void handleMetricsExport()
+    {
+        if (!currentUser || (currentUser->getUserType() != "admin" &&
+                             currentUser->getUserType() != "librarian"))
+        {
+            cout << "Access denied. Admin/Librarian privileges required." << endl;
+            return;
+        }
+
+        string path;
+        cout << "Enter metrics output file (e.g. lms_metrics.prom): ";
+        cin >> path;
+        tick();
+        if (!refreshConsoleSession())
+            return;
+
+        if (metrics.exportPrometheus(path))
+        {
+            cout << "Metrics written to " << path << endl;
+        }
+        else
+        {
+            cout << "Failed to write metrics to " << path << endl;
+        }
+    }
+
+    const LibraryMetrics &getMetrics() const { return metrics; }
+
+    void displayAllUsers(const User *viewer) const
+    {
+        ScopedOpTimer timer(metrics, OP_REPORT_USERS);
+        if (traceRecorder)
+            trace("REPORT", {"users"});
+        if (!viewer || (viewer->getUserType() != "admin" &&
+                             viewer->getUserType() != "librarian"))
+        {
+            cout << "Access denied. Admin/Librarian privileges required." << endl;
+            timer.fail();
+            return;
+        }
+
+        cout << "\n=== ALL USERS ===" << endl;
+        for (const auto &user : users)
+        {
+            cout << "\n------------------------" << endl;
+            user.displayInfo();
+        }
+    }
+
+    // Main application loop
+    void run()
+    {
+        int choice;
+
+        cout << "Welcome to the Library Management System!" << endl;
+
+        while (true)
+        {
+            // Each menu action refreshes the session's idle timer
+            refreshConsoleSession();
+
+            if (!isLoggedIn())
+            {
+                showMainMenu();
+                cin >> choice;
+                tick(); // time passed while waiting for input
+
+                switch (choice)
+                {
+                case 1:
+                {
+                    string username, password;
+                    cout << "Enter username: ";
+                    cin >> username;
+                    cout << "Enter password: ";
+                    cin >> password;
+                    login(username, password);
+                    break;
+                }
+                case 2:
+                    handleUserRegistration();
+                    break;
+                case 3:
+                    browseCatalog();
+                    break;
+                case 4:
+                    handleBookSearch();
+                    break;
+                case 0:
+                    cout << "Thank you for using Library Management System!" << endl;
+                    return;
+                default:
+                    cout << "Invalid option. Please try again." << endl;
+                }
+            }
+            else
+            {
+                showUserMenu();
+                cin >> choice;
+
+                // The menu may have waited past the idle timeout, or past
+                // midnight; refresh both before acting
+                tick();
+                if (!refreshConsoleSession())
+                    continue;
+
+                switch (choice)
+                {
+                case 1:
+                    browseCatalog();
+                    break;
+                case 2:
+                    handleBookSearch();
+                    break;
+                case 3:
+                    handleBookIssue();
+                    break;
+                case 4:
+                    handleBookReturn();
+                    break;
+                case 5:
+                    displayUserTransactions(currentUser);
+                    break;
+                case 6:
+                    displayAccount();
+                    break;
+                case 7:
+                    if (currentUser->getUserType() == "admin" ||
+                        currentUser->getUserType() == "librarian")
+                    {
+                        handleDynamicAddBook();
+                    }
+                    else
+                    {
+                        cout << "Invalid option." << endl;
+                    }
+                    break;
+                case 8:
+                    if (currentUser->getUserType() == "admin" ||
                         currentUser->getUserType() == "librarian")
                     {
-                        handleDynamicAddBook();
+                        displayOverdueBooks(currentUser);
                     }
                     else
                     {
                         cout << "Invalid option." << endl;
                     }
                     break;
-                case 8:
+                case 9:
                     if (currentUser->getUserType() == "admin" ||
                         currentUser->getUserType() == "librarian")
                     {
-                        displayOverdueBooks();
+                        displayAllUsers(currentUser);
                     }
                     else
                     {
                         cout << "Invalid option." << endl;
                     }
                     break;
-                case 9:
+                case 10:
+                    if (currentUser->getUserType() == "admin" ||
+                        currentUser->getUserType() == "librarian")
+                    {
+                        handleMetricsExport();
+                    }
+                    else
+                    {
+                        cout << "Invalid option." << endl;
+                    }
+                    break;
+                case 11:
+                    if (currentUser->getUserType() == "admin" ||
+                        currentUser->getUserType() == "librarian")
+                    {
+                        displayOutstandingFines(currentUser);
+                    }
+                    else
+                    {
+                        cout << "Invalid option." << endl;
+                    }
+                    break;
+                case 12:
+                    if (currentUser->getUserType() == "admin" ||
+                        currentUser->getUserType() == "librarian")
+                    {
+                        handleFinePayment();
+                    }
+                    else
+                    {
+                        cout << "Invalid option." << endl;
+                    }
+                    break;
+                case 13:
+                    if (currentUser->getUserType() == "admin" ||
+                        currentUser->getUserType() == "librarian")
+                    {
+                        displayInventoryReport(currentUser);
+                    }
+                    else
+                    {
+                        cout << "Invalid option." << endl;
+                    }
+                    break;
+                case 14:
+                    if (currentUser->getUserType() == "admin" ||
+                        currentUser->getUserType() == "librarian")
+                    {
+                        saveSnapshot();
+                    }
+                    else
+                    {
+                        cout << "Invalid option." << endl;
+                    }
+                    break;
+                case 15:
+                    if (currentUser->getUserType() == "admin" ||
+                        currentUser->getUserType() == "librarian")
+                    {
+                        rebuildRecommendations();
+                    }
+                    else
+                    {
+                        cout << "Invalid option." << endl;
+                    }
+                    break;
+                case 16:
+                    if (currentUser->getUserType() == "admin" ||
+                        currentUser->getUserType() == "librarian")
+                    {
+                        handleAddClosure();
+                    }
+                    else
+                    {
+                        cout << "Invalid option." << endl;
+                    }
+                    break;
+                case 17:
                     if (currentUser->getUserType() == "admin" ||
                         currentUser->getUserType() == "librarian")
                     {
-                        displayAllUsers();
+                        handleWeeklyClosures();
                     }
                     else
                     {
@@ -889,10 +4343,655 @@ public:
     }
 };
 
+// Deterministic random source for trace synthesis. Only raw engine output
+// is used, so a seed yields the same trace with every standard library.
+class TraceRandom
+{
+private:
+    mt19937_64 engine;
+
+public:
+    explicit TraceRandom(uint64_t seed) : engine(seed) {}
+
+    double uniform() { return double(engine() >> 11) * (1.0 / 9007199254740992.0); }
+    size_t below(size_t n) { return size_t(uniform() * n); }
+    double exponential(double mean) { return -log(1.0 - uniform()) * mean; }
+};
+
+// Generates synthetic traces: patrons open sessions at Poisson arrival
+// times and perform a mix of searches, checkouts, returns and reports,
+// with books chosen from a Zipf distribution.
+class TraceSynthesizer
+{
+public:
+    struct Options
+    {
+        long operations;
+        int patrons;
+        int books;
+        double rate;      // operations per second
+        double zipf;      // popularity skew; 0 is uniform
+        uint64_t seed;
+        int firstBookId;  // ID the first synthetic book will receive
+    };
+
+    static Options defaults()
+    {
+        Options options = {100000, 1000, 10000, 2000.0, 1.0, 42, 1005};
+        return options;
+    }
+
+    static string titleFor(int book)
+    {
+        static const char *words[] = {"Silent", "River", "Empire", "Garden", "Shadow",
+                                      "Winter", "Glass", "Stone", "Harbor", "Crown",
+                                      "Ember", "Atlas", "Orchard", "Signal", "Lantern"};
+        const int wordCount = sizeof(words) / sizeof(words[0]);
+        return string(words[book % wordCount]) + " " + words[(book / wordCount) % wordCount] +
+               " " + to_string(book);
+    }
+
+    static vector<TraceOp> synthesize(const Options &options)
+    {
+        static const char *genres[] = {"Fiction", "History", "Science", "Poetry", "Travel"};
+        TraceRandom random(options.seed);
+        vector<TraceOp> ops;
+
+        // Zipf CDF over book ranks
+        vector<double> cdf(options.books);
+        double total = 0.0;
+        for (int rank = 0; rank < options.books; rank++)
+        {
+            total += 1.0 / pow(rank + 1.0, options.zipf);
+            cdf[rank] = total;
+        }
+
+        // Setup block: catalog and patrons at time 0
+        vector<int> available(options.books);
+        for (int book = 0; book < options.books; book++)
+        {
+            available[book] = 1 + int(random.below(4));
+            TraceOp op = {0, 0, "ADD_BOOK",
+                          {titleFor(book), "Author " + to_string(book % 997),
+                           "SYN-" + to_string(book), genres[book % 5],
+                           to_string(available[book]), "19.99", "2000-01-01"}};
+            ops.push_back(op);
+        }
+        const int borrowLimit = 5;
+        for (int patron = 0; patron < options.patrons; patron++)
+        {
+            string name = "patron" + to_string(patron);
+            TraceOp op = {0, 0, "ADD_USER",
+                          {name, "Patron " + to_string(patron), name + "@example.org",
+                           "555-0100", "student", "pw" + to_string(patron),
+                           to_string(borrowLimit)}};
+            ops.push_back(op);
+        }
+        size_t setupOps = ops.size();
+
+        // Operations arrive as one Poisson stream at options.rate, so a trace
+        // of N operations spans about N / rate seconds. Each arrival goes to
+        // one of the open sessions of a few operations each; new sessions
+        // open while fewer than concurrentSessions are active, which spaces
+        // a session's own operations about thinkMs apart. Only the timing and
+        // session structure are laid out here; what each operation does is
+        // decided below, in time order, so it can follow the simulated
+        // library.
+        const int opsPerSession = 6;
+        const double thinkMs = 2000.0;
+        const size_t concurrentSessions =
+            size_t(max(1.0, min(options.rate * thinkMs / 1000.0,
+                                double(options.operations) / (4 * opsPerSession))));
+        struct OpenSession
+        {
+            int client;
+            long remaining; // operations still to come, ending with LOGOUT
+        };
+        vector<OpenSession> openSessions;
+        long pending = 0; // sum of remaining over open sessions
+        double t = 0.0;
+        vector<int> patronOf(1, -1); // client -> patron; client 0 is the setup client
+
+        for (long k = 0; k < options.operations; k++)
+        {
+            t += random.exponential(1000.0 / options.rate);
+            long budget = options.operations - k; // including this one
+
+            // Open a session unless the remaining budget is needed to close
+            // the ones already open
+            bool openNew = budget > pending &&
+                           (openSessions.empty() ||
+                            (openSessions.size() < concurrentSessions &&
+                             random.uniform() < 2.0 / opsPerSession));
+            if (openNew)
+            {
+                // Each session is its own client (a patron may have several
+                // open, e.g. kiosk and web)
+                int patron = int(random.below(options.patrons));
+                int client = int(patronOf.size());
+                patronOf.push_back(patron);
+                TraceOp login = {int64_t(t), client, "LOGIN",
+                                 {"patron" + to_string(patron), "pw" + to_string(patron)}};
+                ops.push_back(login);
+
+                long remaining = min(long(opsPerSession - 1), budget - 1 - pending);
+                if (remaining > 0)
+                {
+                    OpenSession session = {client, remaining};
+                    openSessions.push_back(session);
+                    pending += remaining;
+                }
+                continue;
+            }
+
+            size_t which = random.below(openSessions.size());
+            OpenSession &session = openSessions[which];
+            TraceOp op = {int64_t(t), session.client, "", {}}; // filled in below
+            if (session.remaining == 1)
+                op.op = "LOGOUT";
+            ops.push_back(op);
+            session.remaining--;
+            pending--;
+            if (session.remaining == 0)
+            {
+                openSessions[which] = openSessions.back();
+                openSessions.pop_back();
+            }
+        }
+
+        // Decide each operation against simulated copy counts and borrowing
+        // limits, so checkouts and returns mostly succeed. A popular book
+        // that is out is still requested now and then, as real patrons do.
+        vector<vector<int>> held(options.patrons); // book ranks on loan, per patron
+        auto drawBook = [&]()
+        {
+            int book = int(lower_bound(cdf.begin(), cdf.end(), random.uniform() * total) -
+                           cdf.begin());
+            return min(book, options.books - 1);
+        };
+        auto drawAvailableBook = [&]()
+        {
+            int book = drawBook();
+            for (int attempt = 0; attempt < 3 && available[book] == 0; attempt++)
+                book = drawBook();
+            return book;
+        };
+        auto borrow = [&](int patron, int book)
+        {
+            if (available[book] > 0)
+            {
+                available[book]--;
+                held[patron].push_back(book);
+            }
+        };
+
+        for (size_t i = setupOps; i < ops.size(); i++)
+        {
+            TraceOp &op = ops[i];
+            if (!op.op.empty())
+                continue;
+
+            int patron = patronOf[op.client];
+            vector<int> &loans = held[patron];
+            bool canBorrow = int(loans.size()) < borrowLimit;
+            double pick = random.uniform();
+
+            if (pick < 0.45)
+            {
+                int book = drawBook();
+                op.op = "SEARCH";
+                if (pick < 0.15)
+                    op.args = {"title", titleFor(book).substr(0, 6)};
+                else if (pick < 0.25)
+                    op.args = {"author", "Author " + to_string(book % 997)};
+                else if (pick < 0.40)
+                    op.args = {"suggest", titleFor(book).substr(0, 3)};
+                else if (pick < 0.43)
+                    op.args = {"isbn", "SYN-" + to_string(book)};
+                else
+                    op.args = {"genre", genres[book % 5]};
+            }
+            else if ((pick < 0.70 || loans.empty()) && canBorrow)
+            {
+                int book = drawAvailableBook();
+                op.op = "ISSUE";
+                op.args = {to_string(options.firstBookId + book)};
+                borrow(patron, book);
+            }
+            else if (pick < 0.90 || !canBorrow)
+            {
+                size_t which = random.below(loans.size());
+                op.op = "RETURN";
+                op.args = {to_string(options.firstBookId + loans[which])};
+                available[loans[which]]++;
+                loans.erase(loans.begin() + which);
+            }
+            else if (pick < 0.95)
+            {
+                op.op = "REPORT";
+                op.args = {"transactions"};
+            }
+            else if (pick < 0.98)
+            {
+                // Distinct books, up to the patron's remaining limit
+                op.op = "ISSUE_BATCH";
+                int slots = min(3, borrowLimit - int(loans.size()));
+                vector<int> batch;
+                for (int attempt = 0; attempt < 6 && int(batch.size()) < slots; attempt++)
+                {
+                    int book = drawAvailableBook();
+                    if (find(batch.begin(), batch.end(), book) == batch.end())
+                        batch.push_back(book);
+                }
+                for (int book : batch)
+                {
+                    op.args.push_back(to_string(options.firstBookId + book));
+                    borrow(patron, book);
+                }
+            }
+            else
+            {
+                op.client = 0;
+                op.op = "ADD_BOOK";
+                op.args = {titleFor(options.books + int(i)), "Author 0",
+                           "SYN-NEW-" + to_string(i), "Fiction", "1",
+                           "9.99", "2024-01-01"};
+            }
+        }
+        return ops;
+    }
+};
+
+// Replays a trace open-loop: each operation is issued at its scheduled
+// time regardless of how earlier ones fared, and its latency is measured
+// from that schedule, so queueing delay is included. Clients are pinned to
+// threads; the library applies operations one at a time in trace order,
+// with the virtual clock set from each operation's own timestamp, so
+// outcomes (due dates, fines, rejections) are the same on every run and
+// with any thread count.
+class LoadReplayer
+{
+public:
+    struct Options
+    {
+        int threads;
+        double speed;     // trace seconds replayed per wall second
+        double timeScale; // virtual seconds that pass per trace second
+        time_t epoch;     // virtual time at the start of the trace
+    };
+
+    static Options defaults()
+    {
+        Options options = {4, 1.0, 1.0, 1767225600}; // 2026-01-01 00:00 UTC
+        return options;
+    }
+
+private:
+    static const int KIND_COUNT = 10;
+
+    static int kindOf(const string &op)
+    {
+        static const char *kinds[KIND_COUNT] = {"LOGIN", "LOGOUT", "SEARCH", "ISSUE", "RETURN",
+                                                "ISSUE_BATCH", "RETURN_BATCH", "ADD_BOOK",
+                                                "ADD_USER", "REPORT"};
+        for (int i = 0; i < KIND_COUNT; i++)
+        {
+            if (op == kinds[i])
+                return i;
+        }
+        return -1;
+    }
+
+    static const char *kindName(int kind)
+    {
+        static const char *kinds[KIND_COUNT] = {"LOGIN", "LOGOUT", "SEARCH", "ISSUE", "RETURN",
+                                                "ISSUE_BATCH", "RETURN_BATCH", "ADD_BOOK",
+                                                "ADD_USER", "REPORT"};
+        return kinds[kind];
+    }
+
+    struct ClientState
+    {
+        string token;
+        string username;
+        string password;
+    };
+
+    Options options;
+    LibraryManagementSystem *library;
+    VirtualClock *clock;
+    mutex libraryMutex;
+    size_t nextTurn; // trace position of the next operation to apply
+
+    // Callers hold libraryMutex and it is op's turn
+    bool execute(const TraceOp &op, ClientState &client)
+    {
+        const vector<string> &a = op.args;
+        // Operations run in trace order, so this only moves backwards for
+        // a trace that is not sorted by time; keep the clock monotonic
+        time_t virtualNow = options.epoch + time_t(op.timeMs / 1000.0 * options.timeScale);
+        if (virtualNow > clock->now())
+            clock->set(virtualNow);
+        library->tick();
+
+        // Sessions can idle out in virtual time; log back in transparently
+        if (!client.token.empty() && op.op != "LOGIN" && !library->resolveSession(client.token))
+            client.token = library->openSession(client.username, client.password);
+
+        if (op.op == "LOGIN" && a.size() >= 2)
+        {
+            client.username = a[0];
+            client.password = a[1];
+            client.token = library->openSession(a[0], a[1]);
+            return !client.token.empty();
+        }
+        if (op.op == "LOGOUT")
+        {
+            library->closeSession(client.token);
+            client.token.clear();
+            return true;
+        }
+        if (op.op == "SEARCH" && a.size() >= 2)
+        {
+            if (a[0] == "suggest")
+                library->suggestBooks(a[1]);
+            else
+                library->searchBooks(a[1], a[0]);
+            return true;
+        }
+        if (op.op == "ISSUE" && a.size() >= 1)
+            return library->issueBook(client.token, atoi(a[0].c_str()));
+        if (op.op == "RETURN" && a.size() >= 1)
+            return library->returnBook(client.token, atoi(a[0].c_str()));
+        if (op.op == "ISSUE_BATCH" || op.op == "RETURN_BATCH")
+        {
+            vector<int> bookIds;
+            for (const auto &arg : a)
+                bookIds.push_back(atoi(arg.c_str()));
+            vector<BatchItemResult> results = op.op == "ISSUE_BATCH"
+                                                  ? library->issueBooks(client.token, bookIds, false)
+                                                  : library->returnBooks(client.token, bookIds);
+            for (const auto &result : results)
+            {
+                if (result.success)
+                    return true;
+            }
+            return false;
+        }
+        if (op.op == "ADD_BOOK" && a.size() >= 7)
+        {
+            library->addBook(a[0], a[1], a[2], a[3], atoi(a[4].c_str()),
+                             atof(a[5].c_str()), a[6]);
+            return true;
+        }
+        if (op.op == "ADD_USER" && a.size() >= 7)
+        {
+            library->addUser(a[0], a[1], a[2], a[3], a[4], a[5], atoi(a[6].c_str()));
+            return true;
+        }
+        if (op.op == "REPORT" && a.size() >= 1)
+            return library->runReport(client.token, a[0], a.size() >= 2 ? a[1] : "");
+        return false;
+    }
+
+public:
+    explicit LoadReplayer(const Options &replayOptions)
+        : options(replayOptions), library(nullptr), clock(nullptr), nextTurn(0) {}
+
+    void run(const vector<TraceOp> &trace, ostream &report)
+    {
+        VirtualClock virtualClock(options.epoch);
+        clock = &virtualClock;
+
+        // The library prints as it works; discard that while replaying
+        struct NullBuffer : streambuf
+        {
+            int overflow(int c) { return c; }
+        } nullBuffer;
+        streambuf *consoleBuffer = cout.rdbuf(&nullBuffer);
+
+        LibraryManagementSystem replayLibrary(&virtualClock);
+        library = &replayLibrary;
+
+        // The leading ADD_BOOK/ADD_USER block is setup and is not timed
+        size_t setupOps = 0;
+        map<int, ClientState> setupClients;
+        while (setupOps < trace.size() &&
+               (trace[setupOps].op == "ADD_BOOK" || trace[setupOps].op == "ADD_USER"))
+        {
+            execute(trace[setupOps], setupClients[trace[setupOps].client]);
+            setupOps++;
+        }
+
+        int threadCount = max(1, options.threads);
+        auto ownerOf = [&](size_t position)
+        { return size_t(trace[position].client) % threadCount; };
+        vector<vector<size_t>> perThread(threadCount); // trace positions
+        for (size_t i = setupOps; i < trace.size(); i++)
+            perThread[ownerOf(i)].push_back(i);
+        nextTurn = setupOps;
+
+        // One condition variable per thread, so finishing an operation
+        // wakes only the thread that owns the next one
+        vector<condition_variable> turnReady(threadCount);
+
+        typedef vector<OpStats> KindStats;
+        vector<KindStats> stats(threadCount, KindStats(KIND_COUNT));
+        vector<vector<uint64_t>> maxNanos(threadCount, vector<uint64_t>(KIND_COUNT, 0));
+        int64_t firstMs = setupOps < trace.size() ? trace[setupOps].timeMs : 0;
+        auto start = chrono::steady_clock::now();
+        vector<thread> workers;
+
+        for (int t = 0; t < threadCount; t++)
+        {
+            workers.push_back(thread([&, t]
+                                     {
+                map<int, ClientState> clients;
+                for (size_t position : perThread[t])
+                {
+                    const TraceOp *op = &trace[position];
+                    auto scheduled = start + chrono::microseconds(int64_t(
+                                                 (op->timeMs - firstMs) * 1000.0 / options.speed));
+                    this_thread::sleep_until(scheduled);
+
+                    // Wait for every earlier operation, as a server
+                    // handling requests in arrival order would
+                    bool ok;
+                    {
+                        unique_lock<mutex> lock(libraryMutex);
+                        turnReady[t].wait(lock, [this, position]
+                                          { return nextTurn == position; });
+                        ok = execute(*op, clients[op->client]);
+                        nextTurn++;
+                        if (nextTurn < trace.size())
+                            turnReady[ownerOf(nextTurn)].notify_one();
+                    }
+
+                    uint64_t nanos = uint64_t(chrono::duration_cast<chrono::nanoseconds>(
+                                                  chrono::steady_clock::now() - scheduled)
+                                                  .count());
+                    int kind = kindOf(op->op);
+                    if (kind < 0)
+                        continue;
+                    OpStats &kindStats = stats[t][kind];
+                    kindStats.calls++;
+                    if (!ok)
+                        kindStats.failures++;
+                    kindStats.sumNanos += nanos;
+                    kindStats.buckets[LatencyHistogram::bucketFor(nanos)]++;
+                    maxNanos[t][kind] = max(maxNanos[t][kind], nanos);
+                } }));
+        }
+        for (auto &worker : workers)
+            worker.join();
+        double wallSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        cout.rdbuf(consoleBuffer);
+        library = nullptr;
+        clock = nullptr;
+
+        // Merge the per-thread results
+        OpStats overall;
+        KindStats merged(KIND_COUNT);
+        vector<uint64_t> mergedMax(KIND_COUNT, 0);
+        for (int t = 0; t < threadCount; t++)
+        {
+            for (int k = 0; k < KIND_COUNT; k++)
+            {
+                merged[k].calls += stats[t][k].calls;
+                merged[k].failures += stats[t][k].failures;
+                merged[k].sumNanos += stats[t][k].sumNanos;
+                for (int b = 0; b < LatencyHistogram::BUCKET_COUNT; b++)
+                {
+                    merged[k].buckets[b] += stats[t][k].buckets[b];
+                    overall.buckets[b] += stats[t][k].buckets[b];
+                }
+                overall.calls += stats[t][k].calls;
+                overall.failures += stats[t][k].failures;
+                mergedMax[k] = max(mergedMax[k], maxNanos[t][k]);
+            }
+        }
+
+        report << "\n=== REPLAY REPORT ===" << endl;
+        report << "Operations: " << overall.calls << " timed, " << setupOps
+               << " setup; threads: " << threadCount << ", speed: " << options.speed
+               << "x, time scale: " << options.timeScale << endl;
+        report << "Threads take turns in trace order; operations do not run in parallel."
+               << endl;
+        report << "Wall time: " << wallSeconds << " s, throughput: "
+               << (wallSeconds > 0 ? overall.calls / wallSeconds : 0.0) << " ops/s" << endl;
+        report << "Latency (us)    count   failed      p50      p90      p99    p99.9      max"
+               << endl;
+        for (int k = 0; k <= KIND_COUNT; k++)
+        {
+            const OpStats &row = k < KIND_COUNT ? merged[k] : overall;
+            if (row.calls == 0)
+                continue;
+            uint64_t rowMax = 0;
+            if (k < KIND_COUNT)
+                rowMax = mergedMax[k];
+            else
+                rowMax = *max_element(mergedMax.begin(), mergedMax.end());
+
+            string name = k < KIND_COUNT ? kindName(k) : "ALL";
+            report << name << string(name.size() < 14 ? 14 - name.size() : 1, ' ');
+            // Bucket upper bounds can exceed the largest value actually seen
+            const double columns[] = {double(row.calls), double(row.failures),
+                                      min(row.percentileNanos(0.5), rowMax) / 1e3,
+                                      min(row.percentileNanos(0.9), rowMax) / 1e3,
+                                      min(row.percentileNanos(0.99), rowMax) / 1e3,
+                                      min(row.percentileNanos(0.999), rowMax) / 1e3,
+                                      rowMax / 1e3};
+            for (double value : columns)
+            {
+                string cell = to_string(long(value + 0.5));
+                report << string(cell.size() < 9 ? 9 - cell.size() : 1, ' ') << cell;
+            }
+            report << endl;
+        }
+    }
+};
+
 // Main function
-int main()
+void printUsage(const char *program)
+{
+    cout << "Usage:" << endl;
+    cout << "  " << program << " [--data <path-prefix>] [--record <trace-file>]" << endl;
+    cout << "  " << program << " --synthesize <trace-file> [--ops N] [--patrons N]"
+         << " [--books N] [--rate OPS_PER_SEC] [--zipf S] [--seed N]" << endl;
+    cout << "  " << program << " --replay <trace-file> [--threads N] [--speed X]"
+         << " [--time-scale X]" << endl;
+}
+
+int main(int argc, char *argv[])
 {
+    static const char *knownOptions[] = {"data", "record", "synthesize", "ops", "patrons",
+                                         "books", "rate", "zipf", "seed", "replay",
+                                         "threads", "speed", "time-scale"};
+    map<string, string> options;
+
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        string name = arg.size() > 2 && arg.compare(0, 2, "--") == 0 ? arg.substr(2) : "";
+        if (find(begin(knownOptions), end(knownOptions), name) == end(knownOptions) ||
+            i + 1 >= argc)
+        {
+            cout << "Unknown or incomplete option: " << arg << endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+        options[name] = argv[++i];
+    }
+
+    if (options.count("synthesize"))
+    {
+        TraceSynthesizer::Options synth = TraceSynthesizer::defaults();
+        if (options.count("ops"))
+            synth.operations = atol(options["ops"].c_str());
+        if (options.count("patrons"))
+            synth.patrons = max(1, atoi(options["patrons"].c_str()));
+        if (options.count("books"))
+            synth.books = max(1, atoi(options["books"].c_str()));
+        if (options.count("rate"))
+            synth.rate = atof(options["rate"].c_str());
+        if (options.count("zipf"))
+            synth.zipf = atof(options["zipf"].c_str());
+        if (options.count("seed"))
+            synth.seed = strtoull(options["seed"].c_str(), nullptr, 10);
+
+        TraceRecorder recorder(options["synthesize"]);
+        if (!recorder.isOpen() || synth.rate <= 0)
+        {
+            cout << "Cannot write trace " << options["synthesize"] << endl;
+            return 1;
+        }
+        vector<TraceOp> trace = TraceSynthesizer::synthesize(synth);
+        for (const auto &op : trace)
+            recorder.write(op);
+        cout << "Wrote " << trace.size() << " operations to " << options["synthesize"] << endl;
+        return 0;
+    }
+
+    if (options.count("replay"))
+    {
+        LoadReplayer::Options replay = LoadReplayer::defaults();
+        if (options.count("threads"))
+            replay.threads = max(1, atoi(options["threads"].c_str()));
+        if (options.count("speed"))
+            replay.speed = atof(options["speed"].c_str());
+        if (options.count("time-scale"))
+            replay.timeScale = atof(options["time-scale"].c_str());
+
+        vector<TraceOp> trace;
+        if (!TraceRecorder::load(options["replay"], trace) || replay.speed <= 0)
+        {
+            cout << "Cannot read trace " << options["replay"] << endl;
+            return 1;
+        }
+        LoadReplayer(replay).run(trace, cout);
+        return 0;
+    }
+
     LibraryManagementSystem library;
+    if (options.count("data"))
+    {
+        if (!library.enablePersistence(options["data"]))
+            return 1;
+    }
+
+    unique_ptr<TraceRecorder> recorder;
+    if (options.count("record"))
+    {
+        recorder.reset(new TraceRecorder(options["record"]));
+        if (!recorder->isOpen())
+        {
+            cout << "Cannot write trace " << options["record"] << endl;
+            return 1;
+        }
+        library.setTraceRecorder(recorder.get());
+    }
+
     library.run();
     return 0;
 }